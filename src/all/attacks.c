@@ -0,0 +1,282 @@
+#include "attacks.h"
+
+#ifdef __BMI2__
+	#include <immintrin.h>
+#endif
+
+/*
+ * The attack tables below were generated ahead of time. Entry i of a table holds
+ * every square a piece standing on square i (see location_getindex()) attacks.
+ */
+
+const Bitboard KNIGHT_ATTACKS[64] =
+{
+	UINT64_C(0x0000000000020400), UINT64_C(0x0000000000050800), UINT64_C(0x00000000000a1100), UINT64_C(0x0000000000142200),
+	UINT64_C(0x0000000000284400), UINT64_C(0x0000000000508800), UINT64_C(0x0000000000a01000), UINT64_C(0x0000000000402000),
+	UINT64_C(0x0000000002040004), UINT64_C(0x0000000005080008), UINT64_C(0x000000000a110011), UINT64_C(0x0000000014220022),
+	UINT64_C(0x0000000028440044), UINT64_C(0x0000000050880088), UINT64_C(0x00000000a0100010), UINT64_C(0x0000000040200020),
+	UINT64_C(0x0000000204000402), UINT64_C(0x0000000508000805), UINT64_C(0x0000000a1100110a), UINT64_C(0x0000001422002214),
+	UINT64_C(0x0000002844004428), UINT64_C(0x0000005088008850), UINT64_C(0x000000a0100010a0), UINT64_C(0x0000004020002040),
+	UINT64_C(0x0000020400040200), UINT64_C(0x0000050800080500), UINT64_C(0x00000a1100110a00), UINT64_C(0x0000142200221400),
+	UINT64_C(0x0000284400442800), UINT64_C(0x0000508800885000), UINT64_C(0x0000a0100010a000), UINT64_C(0x0000402000204000),
+	UINT64_C(0x0002040004020000), UINT64_C(0x0005080008050000), UINT64_C(0x000a1100110a0000), UINT64_C(0x0014220022140000),
+	UINT64_C(0x0028440044280000), UINT64_C(0x0050880088500000), UINT64_C(0x00a0100010a00000), UINT64_C(0x0040200020400000),
+	UINT64_C(0x0204000402000000), UINT64_C(0x0508000805000000), UINT64_C(0x0a1100110a000000), UINT64_C(0x1422002214000000),
+	UINT64_C(0x2844004428000000), UINT64_C(0x5088008850000000), UINT64_C(0xa0100010a0000000), UINT64_C(0x4020002040000000),
+	UINT64_C(0x0400040200000000), UINT64_C(0x0800080500000000), UINT64_C(0x1100110a00000000), UINT64_C(0x2200221400000000),
+	UINT64_C(0x4400442800000000), UINT64_C(0x8800885000000000), UINT64_C(0x100010a000000000), UINT64_C(0x2000204000000000),
+	UINT64_C(0x0004020000000000), UINT64_C(0x0008050000000000), UINT64_C(0x00110a0000000000), UINT64_C(0x0022140000000000),
+	UINT64_C(0x0044280000000000), UINT64_C(0x0088500000000000), UINT64_C(0x0010a00000000000), UINT64_C(0x0020400000000000)
+};
+
+const Bitboard KING_ATTACKS[64] =
+{
+	UINT64_C(0x0000000000000302), UINT64_C(0x0000000000000705), UINT64_C(0x0000000000000e0a), UINT64_C(0x0000000000001c14),
+	UINT64_C(0x0000000000003828), UINT64_C(0x0000000000007050), UINT64_C(0x000000000000e0a0), UINT64_C(0x000000000000c040),
+	UINT64_C(0x0000000000030203), UINT64_C(0x0000000000070507), UINT64_C(0x00000000000e0a0e), UINT64_C(0x00000000001c141c),
+	UINT64_C(0x0000000000382838), UINT64_C(0x0000000000705070), UINT64_C(0x0000000000e0a0e0), UINT64_C(0x0000000000c040c0),
+	UINT64_C(0x0000000003020300), UINT64_C(0x0000000007050700), UINT64_C(0x000000000e0a0e00), UINT64_C(0x000000001c141c00),
+	UINT64_C(0x0000000038283800), UINT64_C(0x0000000070507000), UINT64_C(0x00000000e0a0e000), UINT64_C(0x00000000c040c000),
+	UINT64_C(0x0000000302030000), UINT64_C(0x0000000705070000), UINT64_C(0x0000000e0a0e0000), UINT64_C(0x0000001c141c0000),
+	UINT64_C(0x0000003828380000), UINT64_C(0x0000007050700000), UINT64_C(0x000000e0a0e00000), UINT64_C(0x000000c040c00000),
+	UINT64_C(0x0000030203000000), UINT64_C(0x0000070507000000), UINT64_C(0x00000e0a0e000000), UINT64_C(0x00001c141c000000),
+	UINT64_C(0x0000382838000000), UINT64_C(0x0000705070000000), UINT64_C(0x0000e0a0e0000000), UINT64_C(0x0000c040c0000000),
+	UINT64_C(0x0003020300000000), UINT64_C(0x0007050700000000), UINT64_C(0x000e0a0e00000000), UINT64_C(0x001c141c00000000),
+	UINT64_C(0x0038283800000000), UINT64_C(0x0070507000000000), UINT64_C(0x00e0a0e000000000), UINT64_C(0x00c040c000000000),
+	UINT64_C(0x0302030000000000), UINT64_C(0x0705070000000000), UINT64_C(0x0e0a0e0000000000), UINT64_C(0x1c141c0000000000),
+	UINT64_C(0x3828380000000000), UINT64_C(0x7050700000000000), UINT64_C(0xe0a0e00000000000), UINT64_C(0xc040c00000000000),
+	UINT64_C(0x0203000000000000), UINT64_C(0x0507000000000000), UINT64_C(0x0a0e000000000000), UINT64_C(0x141c000000000000),
+	UINT64_C(0x2838000000000000), UINT64_C(0x5070000000000000), UINT64_C(0xa0e0000000000000), UINT64_C(0x40c0000000000000)
+};
+
+/* Pawns only attack diagonally forward, so there is one table per color. Index with color - 1. */
+const Bitboard PAWN_ATTACKS[2][64] =
+{
+	{
+		UINT64_C(0x0000000000000200), UINT64_C(0x0000000000000500), UINT64_C(0x0000000000000a00), UINT64_C(0x0000000000001400),
+		UINT64_C(0x0000000000002800), UINT64_C(0x0000000000005000), UINT64_C(0x000000000000a000), UINT64_C(0x0000000000004000),
+		UINT64_C(0x0000000000020000), UINT64_C(0x0000000000050000), UINT64_C(0x00000000000a0000), UINT64_C(0x0000000000140000),
+		UINT64_C(0x0000000000280000), UINT64_C(0x0000000000500000), UINT64_C(0x0000000000a00000), UINT64_C(0x0000000000400000),
+		UINT64_C(0x0000000002000000), UINT64_C(0x0000000005000000), UINT64_C(0x000000000a000000), UINT64_C(0x0000000014000000),
+		UINT64_C(0x0000000028000000), UINT64_C(0x0000000050000000), UINT64_C(0x00000000a0000000), UINT64_C(0x0000000040000000),
+		UINT64_C(0x0000000200000000), UINT64_C(0x0000000500000000), UINT64_C(0x0000000a00000000), UINT64_C(0x0000001400000000),
+		UINT64_C(0x0000002800000000), UINT64_C(0x0000005000000000), UINT64_C(0x000000a000000000), UINT64_C(0x0000004000000000),
+		UINT64_C(0x0000020000000000), UINT64_C(0x0000050000000000), UINT64_C(0x00000a0000000000), UINT64_C(0x0000140000000000),
+		UINT64_C(0x0000280000000000), UINT64_C(0x0000500000000000), UINT64_C(0x0000a00000000000), UINT64_C(0x0000400000000000),
+		UINT64_C(0x0002000000000000), UINT64_C(0x0005000000000000), UINT64_C(0x000a000000000000), UINT64_C(0x0014000000000000),
+		UINT64_C(0x0028000000000000), UINT64_C(0x0050000000000000), UINT64_C(0x00a0000000000000), UINT64_C(0x0040000000000000),
+		UINT64_C(0x0200000000000000), UINT64_C(0x0500000000000000), UINT64_C(0x0a00000000000000), UINT64_C(0x1400000000000000),
+		UINT64_C(0x2800000000000000), UINT64_C(0x5000000000000000), UINT64_C(0xa000000000000000), UINT64_C(0x4000000000000000),
+		UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000),
+		UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)
+	},
+	{
+		UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000),
+		UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000),
+		UINT64_C(0x0000000000000002), UINT64_C(0x0000000000000005), UINT64_C(0x000000000000000a), UINT64_C(0x0000000000000014),
+		UINT64_C(0x0000000000000028), UINT64_C(0x0000000000000050), UINT64_C(0x00000000000000a0), UINT64_C(0x0000000000000040),
+		UINT64_C(0x0000000000000200), UINT64_C(0x0000000000000500), UINT64_C(0x0000000000000a00), UINT64_C(0x0000000000001400),
+		UINT64_C(0x0000000000002800), UINT64_C(0x0000000000005000), UINT64_C(0x000000000000a000), UINT64_C(0x0000000000004000),
+		UINT64_C(0x0000000000020000), UINT64_C(0x0000000000050000), UINT64_C(0x00000000000a0000), UINT64_C(0x0000000000140000),
+		UINT64_C(0x0000000000280000), UINT64_C(0x0000000000500000), UINT64_C(0x0000000000a00000), UINT64_C(0x0000000000400000),
+		UINT64_C(0x0000000002000000), UINT64_C(0x0000000005000000), UINT64_C(0x000000000a000000), UINT64_C(0x0000000014000000),
+		UINT64_C(0x0000000028000000), UINT64_C(0x0000000050000000), UINT64_C(0x00000000a0000000), UINT64_C(0x0000000040000000),
+		UINT64_C(0x0000000200000000), UINT64_C(0x0000000500000000), UINT64_C(0x0000000a00000000), UINT64_C(0x0000001400000000),
+		UINT64_C(0x0000002800000000), UINT64_C(0x0000005000000000), UINT64_C(0x000000a000000000), UINT64_C(0x0000004000000000),
+		UINT64_C(0x0000020000000000), UINT64_C(0x0000050000000000), UINT64_C(0x00000a0000000000), UINT64_C(0x0000140000000000),
+		UINT64_C(0x0000280000000000), UINT64_C(0x0000500000000000), UINT64_C(0x0000a00000000000), UINT64_C(0x0000400000000000),
+		UINT64_C(0x0002000000000000), UINT64_C(0x0005000000000000), UINT64_C(0x000a000000000000), UINT64_C(0x0014000000000000),
+		UINT64_C(0x0028000000000000), UINT64_C(0x0050000000000000), UINT64_C(0x00a0000000000000), UINT64_C(0x0040000000000000)
+	}
+};
+
+
+/*
+ * Sliding pieces use magic bitboards. For every square the occupancy of the squares a
+ * bishop or rook could be blocked on (the mask) is hashed into an index into that
+ * square's slice of a shared attack table. With BMI2 the hash is a single PEXT
+ * instruction, otherwise it's a multiplication by the square's magic number.
+ */
+typedef struct
+{
+	Bitboard mask;
+	Bitboard magic;
+	Bitboard *attacks;
+	uint_fast8_t shift;
+} Magic;
+
+static const Bitboard ROOK_MAGIC_NUMBERS[64] =
+{
+	UINT64_C(0x1080004008801020), UINT64_C(0x0840092002c03000), UINT64_C(0x1900200010400900), UINT64_C(0x0880100008000480),
+	UINT64_C(0x4200100420080200), UINT64_C(0x8100020100080400), UINT64_C(0x0200040110886200), UINT64_C(0x0200008040220411),
+	UINT64_C(0x0404800084400220), UINT64_C(0x0000401000402000), UINT64_C(0x0086001081220440), UINT64_C(0x0408800800100280),
+	UINT64_C(0x000a001201040820), UINT64_C(0x8848800200840080), UINT64_C(0x4001000100040200), UINT64_C(0x0442000102105084),
+	UINT64_C(0x9080010020804100), UINT64_C(0x0040404000201009), UINT64_C(0x0000808010002009), UINT64_C(0x2200090021d00100),
+	UINT64_C(0x0008008008040080), UINT64_C(0x0004004002010040), UINT64_C(0x0011040008015042), UINT64_C(0x00000a0001768104),
+	UINT64_C(0x0000800080204009), UINT64_C(0x2010004140002001), UINT64_C(0x9800200280100080), UINT64_C(0x1000100080080080),
+	UINT64_C(0x0442000a00049020), UINT64_C(0x2100040080020080), UINT64_C(0x0800120400900148), UINT64_C(0x0010040a00128541),
+	UINT64_C(0x2800804000800030), UINT64_C(0x1010002000400041), UINT64_C(0x4000200011004100), UINT64_C(0x0610008410800800),
+	UINT64_C(0x0400802402800800), UINT64_C(0xc100020080800400), UINT64_C(0x0002000802000401), UINT64_C(0x0182085882000401),
+	UINT64_C(0x0220204000808000), UINT64_C(0x2860100040024022), UINT64_C(0x0001002004110040), UINT64_C(0x99101042000a0020),
+	UINT64_C(0x0004080004008080), UINT64_C(0x0010040002008080), UINT64_C(0x2012004881020004), UINT64_C(0x8300842444820011),
+	UINT64_C(0x0088403882010200), UINT64_C(0x0820400080210100), UINT64_C(0x0110910040a00300), UINT64_C(0x0801100280080480),
+	UINT64_C(0x0242009008200600), UINT64_C(0x1002000489500200), UINT64_C(0x0040800200010080), UINT64_C(0x0091800041000080),
+	UINT64_C(0x0000209300488001), UINT64_C(0x04c1002414824001), UINT64_C(0x020020000b001041), UINT64_C(0x7000100004200901),
+	UINT64_C(0x8002002004100802), UINT64_C(0x30010002084c0007), UINT64_C(0x0888221800813004), UINT64_C(0x4000002840840112)
+};
+
+static const Bitboard BISHOP_MAGIC_NUMBERS[64] =
+{
+	UINT64_C(0xa010041108003100), UINT64_C(0x006082020a002900), UINT64_C(0x6810010619200000), UINT64_C(0x08281a0520000408),
+	UINT64_C(0x0001104001000400), UINT64_C(0x0018901008048400), UINT64_C(0x00040a0210245280), UINT64_C(0x000200210808a402),
+	UINT64_C(0x9140048410821200), UINT64_C(0x0800091010820041), UINT64_C(0x20504804832202c0), UINT64_C(0x0100091401081000),
+	UINT64_C(0x8021011140000012), UINT64_C(0x0810020804450400), UINT64_C(0x208b0542109008a2), UINT64_C(0x0080084a08040204),
+	UINT64_C(0x0040e2a80811244c), UINT64_C(0x2505022008008108), UINT64_C(0x0430220100420040), UINT64_C(0x010a040420220040),
+	UINT64_C(0x1105000290400000), UINT64_C(0x0093001200822120), UINT64_C(0x4000a62048043004), UINT64_C(0x280120048a015004),
+	UINT64_C(0x006090002a020814), UINT64_C(0x44042000240800d0), UINT64_C(0x01102800040a4400), UINT64_C(0x1004080080220040),
+	UINT64_C(0x0001001011004024), UINT64_C(0x0010044000805040), UINT64_C(0x0914041200820100), UINT64_C(0x0004821012821480),
+	UINT64_C(0x0024040500c05021), UINT64_C(0x0088611002080200), UINT64_C(0x0116080a00040020), UINT64_C(0x4000020080080080),
+	UINT64_C(0x2450450140840040), UINT64_C(0x0000880201484100), UINT64_C(0x0222020404020092), UINT64_C(0x8081110600002e00),
+	UINT64_C(0x2842101105000801), UINT64_C(0x1100809008001025), UINT64_C(0x00020202221c0400), UINT64_C(0x0422014022009020),
+	UINT64_C(0x0210046102100c00), UINT64_C(0xc004008082029102), UINT64_C(0x00aa461801101200), UINT64_C(0x0404080080201108),
+	UINT64_C(0x020542108c205002), UINT64_C(0x0410544804100100), UINT64_C(0x0040910841100000), UINT64_C(0x0400200042021100),
+	UINT64_C(0x00004204850400c0), UINT64_C(0x0200100410a42102), UINT64_C(0x1040020801210102), UINT64_C(0x0805040410420000),
+	UINT64_C(0x2884804130100200), UINT64_C(0x800c262201242000), UINT64_C(0x1058000194108800), UINT64_C(0x0014221054420204),
+	UINT64_C(0x0104000012a02200), UINT64_C(0x0200881003300100), UINT64_C(0x0140400202840100), UINT64_C(0x0402020801010201)
+};
+
+static const int_fast8_t ROOK_DIRECTIONS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static const int_fast8_t BISHOP_DIRECTIONS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+static Magic ROOK_MAGICS[64];
+static Magic BISHOP_MAGICS[64];
+
+static Bitboard ROOK_TABLE[0x19000];
+static Bitboard BISHOP_TABLE[0x1480];
+
+static bool initialized = false;
+
+/**
+ * Walks outwards from a square in each of the given directions until it falls off
+ * the board or runs into an occupied square. Only used to fill the attack tables.
+ *
+ * @param index      The square the piece is standing on
+ * @param occupancy  Every occupied square on the board
+ * @param directions The four (file, rank) directions the piece slides in
+ *
+ * @return every square the piece attacks
+ */
+static Bitboard slide(uint_fast8_t index, Bitboard occupancy, const int_fast8_t directions[4][2])
+{
+	Bitboard ret = BB_EMPTY;
+	uint_fast8_t i;
+
+	for(i = 0; i < 4; i++)
+	{
+		int_fast8_t h = index % 8 + directions[i][0];
+		int_fast8_t v = index / 8 + directions[i][1];
+
+		while(h >= 0 && h < 8 && v >= 0 && v < 8)
+		{
+			ret |= BB_SQUARE(v * 8 + h);
+
+			if(occupancy & BB_SQUARE(v * 8 + h))
+				break;
+
+			h += directions[i][0];
+			v += directions[i][1];
+		}
+	}
+
+	return ret;
+}
+
+static uint_fast32_t magic_index(const Magic *m, Bitboard occupancy)
+{
+#ifdef __BMI2__
+	return _pext_u64(occupancy, m->mask);
+#else
+	return ((occupancy & m->mask) * m->magic) >> m->shift;
+#endif
+}
+
+static void init_magics(Magic *magics, Bitboard *table, const Bitboard *numbers, const int_fast8_t directions[4][2])
+{
+	uint_fast8_t i;
+
+	for(i = 0; i < 64; i++)
+	{
+		const Bitboard ranks = (BB_RANK_1 | BB_RANK_8) & ~(BB_RANK_1 << (8 * (i / 8)));
+		const Bitboard files = (BB_FILE_A | BB_FILE_H) & ~(BB_FILE_A << (i % 8));
+		Magic *m = &magics[i];
+		Bitboard subset;
+
+		/* The edge of the board can't block anything so it's left out of the mask */
+		m->mask = slide(i, BB_EMPTY, directions) & ~(ranks | files);
+		m->magic = numbers[i];
+		m->shift = 64 - bitboard_count(m->mask);
+		m->attacks = table;
+
+		/* Enumerate every subset of the mask */
+		subset = BB_EMPTY;
+		do
+		{
+			m->attacks[magic_index(m, subset)] = slide(i, subset, directions);
+			subset = (subset - m->mask) & m->mask;
+		} while(subset != BB_EMPTY);
+
+		table += (uint_fast32_t)1 << bitboard_count(m->mask);
+	}
+}
+
+/**
+ * Fills the sliding piece attack tables. Has to be called before bishop_attacks(),
+ * rook_attacks() or queen_attacks() are used. Calling it again does nothing.
+ */
+void attacks_init()
+{
+	if(!initialized)
+	{
+		init_magics(ROOK_MAGICS, ROOK_TABLE, ROOK_MAGIC_NUMBERS, ROOK_DIRECTIONS);
+		init_magics(BISHOP_MAGICS, BISHOP_TABLE, BISHOP_MAGIC_NUMBERS, BISHOP_DIRECTIONS);
+
+		initialized = true;
+	}
+}
+
+/**
+ * Gives every square a bishop attacks, stopping at (and including) the first
+ * occupied square in each direction.
+ *
+ * @param index      The square the bishop is on
+ * @param occupancy  Every occupied square on the board
+ *
+ * @return the squares the bishop attacks
+ */
+Bitboard bishop_attacks(uint_fast8_t index, Bitboard occupancy)
+{
+	const Magic *m = &BISHOP_MAGICS[index];
+
+	return m->attacks[magic_index(m, occupancy)];
+}
+
+/**
+ * Gives every square a rook attacks, stopping at (and including) the first
+ * occupied square in each direction.
+ *
+ * @param index      The square the rook is on
+ * @param occupancy  Every occupied square on the board
+ *
+ * @return the squares the rook attacks
+ */
+Bitboard rook_attacks(uint_fast8_t index, Bitboard occupancy)
+{
+	const Magic *m = &ROOK_MAGICS[index];
+
+	return m->attacks[magic_index(m, occupancy)];
+}
+
+Bitboard queen_attacks(uint_fast8_t index, Bitboard occupancy)
+{
+	return bishop_attacks(index, occupancy) | rook_attacks(index, occupancy);
+}
@@ -0,0 +1,16 @@
+#ifndef ATTACKS_H_INCLUDED
+#define ATTACKS_H_INCLUDED
+
+#include "bitboard.h"
+
+extern const Bitboard KNIGHT_ATTACKS[64];
+extern const Bitboard KING_ATTACKS[64];
+extern const Bitboard PAWN_ATTACKS[2][64];
+
+void attacks_init();
+
+Bitboard bishop_attacks(uint_fast8_t, Bitboard);
+Bitboard rook_attacks(uint_fast8_t, Bitboard);
+Bitboard queen_attacks(uint_fast8_t, Bitboard);
+
+#endif /* ATTACKS_H_INCLUDED */
@@ -0,0 +1,337 @@
+#define _POSIX_C_SOURCE 200112L    /* for pthreads, clock_gettime() and sysconf() */
+
+#include "attacks.h"
+#include "batch.h"
+#include "logichelp.h"
+#include "statuscache.h"
+#include "zobrist.h"
+
+#ifdef BATCH_CAN_THREAD
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+/*
+ * Replays every game of a PGN file on a pool of worker threads. Games don't depend on each
+ * other, so each worker owns everything it touches: its own game, status cache, index and
+ * reader on the file. The only thing they share is the queue of game numbers, which they
+ * take BATCH_CHUNK at a time so they hardly ever wait on each other for it. Each worker
+ * keeps its own report, and they're only added up once every worker is done.
+ */
+
+/* The games that are left. next and count are only touched with lock held */
+typedef struct
+{
+	uintmax_t next;
+	uintmax_t count;
+#ifdef BATCH_CAN_THREAD
+	pthread_mutex_t lock;
+#endif
+} BatchQueue;
+
+typedef struct
+{
+	BatchQueue *queue;
+	PGNIndex index;
+	PGNReader reader;
+	BatchReport report;
+#ifdef BATCH_CAN_THREAD
+	pthread_t thread;
+#endif
+} BatchWorker;
+
+/* The clock on the wall in seconds, since CPU time adds up every thread's */
+static double batch_now()
+{
+#ifdef BATCH_CAN_THREAD
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+#else
+	return ((double) clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+/**
+ * @return how many threads batch_replay() uses when it isn't told, one for each processor
+ */
+uint_fast16_t batch_default_threads()
+{
+#ifdef BATCH_CAN_THREAD
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if(processors > BATCH_MAX_THREADS) return BATCH_MAX_THREADS;
+	if(processors > 0) return processors;
+#endif
+
+	return 1;
+}
+
+/* Takes the next games off the queue. Returns how many there are, starting with first */
+static uintmax_t batch_take(BatchQueue *queue, uintmax_t *first)
+{
+	uintmax_t taken;
+
+#ifdef BATCH_CAN_THREAD
+	pthread_mutex_lock(&(queue->lock));
+#endif
+
+	taken = queue->count - queue->next < BATCH_CHUNK ? queue->count - queue->next : BATCH_CHUNK;
+	*first = queue->next + 1;
+	queue->next += taken;
+
+#ifdef BATCH_CAN_THREAD
+	pthread_mutex_unlock(&(queue->lock));
+#endif
+
+	return taken;
+}
+
+static void batch_add_problem(BatchReport *report, const BatchProblem *problem)
+{
+	if(report->problemCount == report->problemCapacity)
+	{
+		report->problemCapacity = report->problemCapacity == 0 ? 16 : 2 * report->problemCapacity;
+		report->problems = realloc(report->problems, report->problemCapacity * sizeof(BatchProblem));
+		assert(report->problems != NULL);
+	}
+
+	report->problems[report->problemCount++] = *problem;
+}
+
+/* Writes the result the position on board forces into result, or leaves it empty if the game could go on */
+static void board_result(Game *board, char *result)
+{
+	const Ply *last = get_latest_move(board->Moves);
+
+	result[0] = '\0';
+
+	if(last != NULL && (last->notes & PLY_MATE))
+		string_copy(result, whose_turn(board) == TEAM_WHITE ? "0-1" : "1-0");
+	else if(position_status(board) & CHECK_STALEMATE)
+		string_copy(result, "1/2-1/2");
+}
+
+/* Replays one game and adds it to report */
+static void batch_game(BatchWorker *worker, Game *board, uintmax_t number)
+{
+	BatchReport *report = &(worker->report);
+	BatchProblem problem;
+	PGNGame game;
+	const char *tag;
+	bool FILE_CHANGED_DURING_BATCH, legal;
+
+	FILE_CHANGED_DURING_BATCH = pgn_index_game(&(worker->index), number, &game) && pgn_seek(&(worker->reader), game.offset, game.length);
+	assert(FILE_CHANGED_DURING_BATCH);
+
+	game_reset(board);
+	legal = replay_game(board, &(worker->reader), &(problem.replay));
+
+	report->games++;
+	report->plies += problem.replay.plies;
+
+	problem.number = number;
+	tag = pgn_tag(&game, "Result");
+	string_copy(problem.tag, tag != NULL && string_getlen(tag) < RESULT_LENGTH ? tag : "");
+	problem.board[0] = '\0';
+
+	if(!legal)
+	{
+		report->illegal++;
+		batch_add_problem(report, &problem);
+		return;
+	}
+
+	board_result(board, problem.board);
+
+	if((problem.tag[0] != '\0' && !string_matches(problem.tag, problem.replay.result))
+		|| (problem.board[0] != '\0' && !string_matches(problem.board, problem.replay.result)))
+	{
+		report->mismatches++;
+		batch_add_problem(report, &problem);
+	}
+}
+
+/* What each worker runs: replays games off the queue until there aren't any left */
+static void *batch_work(void *arg)
+{
+	BatchWorker *worker = arg;
+	Game *board = init_game();
+	StatusCache *cache = status_cache_init(STATUS_CACHE_ENTRIES);
+	uintmax_t first, taken, i;
+
+	board->statusCache = cache;
+
+	while((taken = batch_take(worker->queue, &first)) > 0)
+		for(i = first; i < first + taken; i++)
+			batch_game(worker, board, i);
+
+	status_cache_free(cache);
+	free_game(board);
+
+	return NULL;
+}
+
+static int batch_problem_order(const void *a, const void *b)
+{
+	const BatchProblem *x = a, *y = b;
+
+	return x->number < y->number ? -1 : x->number > y->number;
+}
+
+/**
+ * Replays every game of a PGN file, spread over a number of threads, and checks each of
+ * them: every move has to be legal, and the result the game ends with has to agree with its
+ * Result tag pair and with the final position if that's mate or stalemate.
+ *
+ * @param filename  The PGN file
+ * @param threads   How many threads to replay on, 0 for batch_default_threads()
+ * @param report    Set to what was found, to be freed with free_batch_report()
+ *
+ * @return false if the file couldn't be read
+ */
+bool batch_replay(const char *filename, uint_fast16_t threads, BatchReport *report)
+{
+	BatchWorker *workers;
+	BatchQueue queue;
+	uint_fast16_t i;
+	uintmax_t j;
+	double start;
+
+	report->games = report->plies = report->illegal = report->mismatches = 0;
+	report->problems = NULL;
+	report->problemCount = report->problemCapacity = 0;
+
+	if(threads == 0) threads = batch_default_threads();
+	if(threads > BATCH_MAX_THREADS) threads = BATCH_MAX_THREADS;
+#ifndef BATCH_CAN_THREAD
+	threads = 1;
+#endif
+
+	/* The tables every game looks things up in are filled in before there's more than one thread */
+	attacks_init();
+	zobrist_init();
+
+	workers = malloc(threads * sizeof(BatchWorker));
+	assert(workers != NULL);
+
+	for(i = 0; i < threads; i++)
+	{
+		workers[i].queue = &queue;
+		workers[i].report = *report;
+
+		if(!pgn_index_open(&(workers[i].index), filename))
+			break;
+
+		/* A temporary index can't be opened again, so one worker has to do */
+		if(workers[i].index.temporary) threads = 1;
+
+		if(!pgn_open(&(workers[i].reader), filename))
+		{
+			pgn_index_close(&(workers[i].index));
+			break;
+		}
+	}
+
+	if(i < threads)
+	{
+		while(i-- > 0)
+		{
+			pgn_close(&(workers[i].reader));
+			pgn_index_close(&(workers[i].index));
+		}
+		free(workers);
+
+		return false;
+	}
+
+	queue.next = 0;
+	queue.count = workers[0].index.count;
+	report->threads = threads;
+
+	start = batch_now();
+
+#ifdef BATCH_CAN_THREAD
+	pthread_mutex_init(&(queue.lock), NULL);
+
+	for(i = 1; i < threads; i++)
+	{
+		bool THREAD_NOT_STARTED = pthread_create(&(workers[i].thread), NULL, batch_work, &(workers[i])) == 0;
+		assert(THREAD_NOT_STARTED);
+	}
+#endif
+
+	/* The calling thread is the first worker */
+	batch_work(&(workers[0]));
+
+#ifdef BATCH_CAN_THREAD
+	for(i = 1; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	pthread_mutex_destroy(&(queue.lock));
+#endif
+
+	report->seconds = batch_now() - start;
+
+	for(i = 0; i < threads; i++)
+	{
+		const BatchReport *part = &(workers[i].report);
+
+		report->games += part->games;
+		report->plies += part->plies;
+		report->illegal += part->illegal;
+		report->mismatches += part->mismatches;
+
+		for(j = 0; j < part->problemCount; j++)
+			batch_add_problem(report, &(part->problems[j]));
+
+		free(part->problems);
+		pgn_close(&(workers[i].reader));
+		pgn_index_close(&(workers[i].index));
+	}
+
+	free(workers);
+
+	if(report->problemCount > 0)
+		qsort(report->problems, report->problemCount, sizeof(BatchProblem), batch_problem_order);
+
+	return true;
+}
+
+/**
+ * Prints every game batch_replay() found a problem with, then how many games and plies it
+ * replayed and how fast.
+ *
+ * @param report  What batch_replay() found
+ */
+void print_batch_report(const BatchReport *report)
+{
+	uintmax_t i;
+
+	for(i = 0; i < report->problemCount; i++)
+	{
+		const BatchProblem *problem = &(report->problems[i]);
+
+		printf("Game %" PRIuMAX ": ", problem->number);
+
+		if(problem->replay.illegal[0] != '\0')
+			printf("illegal move %s after %" PRIuMAX " plies\n", problem->replay.illegal, problem->replay.plies);
+		else if(problem->tag[0] != '\0' && !string_matches(problem->tag, problem->replay.result))
+			printf("ends %s but its Result tag is %s\n", problem->replay.result, problem->tag);
+		else
+			printf("ends %s but the final position is %s\n", problem->replay.result, problem->board);
+	}
+
+	printf("%" PRIuMAX " games, %" PRIuMAX " plies in %.3lfs on %" PRIuFAST16 " thread%s", report->games, report->plies, report->seconds, report->threads, report->threads == 1 ? "" : "s");
+	if(report->seconds > 0) printf(" (%.0lf games/s, %.0lf plies/s)", report->games / report->seconds, report->plies / report->seconds);
+	printf("\n%" PRIuMAX " with illegal moves, %" PRIuMAX " with mismatched results\n", report->illegal, report->mismatches);
+}
+
+void free_batch_report(BatchReport *report)
+{
+	free(report->problems);
+	report->problems = NULL;
+	report->problemCount = report->problemCapacity = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include "pgnindex.h"
+#include "replay.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define BATCH_CAN_THREAD 1  /* games are replayed on a pool of POSIX threads */
+#endif
+
+/* A game that didn't replay cleanly, see batch_replay() */
+typedef struct
+{
+	uintmax_t number;
+	Replay replay;
+	char tag[RESULT_LENGTH];    /* the game's Result tag pair, empty if it doesn't have one */
+	char board[RESULT_LENGTH];  /* the result the final position forces, empty if it doesn't force one */
+} BatchProblem;
+
+/* What replaying every game of a file came to */
+typedef struct
+{
+	uintmax_t games;
+	uintmax_t plies;
+	uintmax_t illegal;          /* games with a move that couldn't be played */
+	uintmax_t mismatches;       /* games whose result disagrees with their Result tag or their final position */
+	BatchProblem *problems;     /* both kinds, in the order the games are in the file */
+	uintmax_t problemCount;
+	uintmax_t problemCapacity;
+	uint_fast16_t threads;
+	double seconds;             /* how long it took by the clock on the wall */
+} BatchReport;
+
+uint_fast16_t batch_default_threads();
+bool batch_replay(const char*, uint_fast16_t, BatchReport*);
+void print_batch_report(const BatchReport*);
+void free_batch_report(BatchReport*);
+
+#endif /* BATCH_H_INCLUDED */
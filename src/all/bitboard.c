@@ -0,0 +1,52 @@
+#include "bitboard.h"
+
+/**
+ * Counts the number of squares in a bitboard.
+ *
+ * @param bb The bitboard being counted
+ *
+ * @return the number of bits set in bb
+ */
+uint_fast8_t bitboard_count(Bitboard bb)
+{
+#ifdef __GNUC__
+	return __builtin_popcountll(bb);
+#else
+	uint_fast8_t ret = 0;
+
+	while(bb != BB_EMPTY)
+	{
+		bb &= bb - 1;
+		ret++;
+	}
+
+	return ret;
+#endif
+}
+
+/**
+ * Finds the lowest square in a bitboard. Paired with bb &= bb - 1 this is how
+ * the squares of a bitboard are iterated over.
+ *
+ * @param bb The bitboard being searched. Must not be empty
+ *
+ * @return the index of the lowest set bit in bb
+ */
+uint_fast8_t bitboard_first(Bitboard bb)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(bb);
+#else
+	uint_fast8_t ret = 0;
+
+	assert(bb != BB_EMPTY);
+
+	while(!(bb & 1))
+	{
+		bb >>= 1;
+		ret++;
+	}
+
+	return ret;
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef BITBOARD_H_INCLUDED
+#define BITBOARD_H_INCLUDED
+
+#include "location.h"
+
+/*
+ * A bitboard holds one bit per square of the chessboard. Bit 0 is a1, bit 7 is h1
+ * and bit 63 is h8, which matches the index given by location_getindex().
+ */
+typedef uint_least64_t Bitboard;
+
+#define         BB_EMPTY                ((Bitboard)0)
+#define         BB_SQUARE(i)            ((Bitboard)1 << (i))
+#define         BB_LOCATION(loc)        BB_SQUARE(location_getindex(loc))
+
+#define         BB_RANK_1               ((Bitboard)0xff)
+#define         BB_RANK_8               (BB_RANK_1 << 56)
+#define         BB_FILE_A               ((Bitboard)UINT64_C(0x0101010101010101))
+#define         BB_FILE_H               (BB_FILE_A << 7)
+
+uint_fast8_t bitboard_count(Bitboard);
+uint_fast8_t bitboard_first(Bitboard);
+
+#endif /* BITBOARD_H_INCLUDED */
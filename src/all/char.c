@@ -71,7 +71,7 @@ uintmax_t string_getlen(const char *str)
 
 void string_copy(char *newstr, const char *str)
 {
-	int_fast8_t i;
+	uintmax_t i;
 	for(i = 0; *(str + i) != '\0'; i++)
 	{
 		newstr[i] = *(str + i);
@@ -198,33 +198,51 @@ bool string_matches_end(const char *str)
 }
 
 /**
- * Takes a given string and removes any character that isn't a piece symbol or a coordinate.
+ * Starts walking through the tokens of a run of chars, the parts of it between each splitter.
+ * Nothing is copied or allocated and the walk is kept entirely in tokens, so any number of
+ * strings can be walked at once, on any number of threads.
  *
- * @param str The move string that will be modified
+ * @param tokens    The walk being started
+ * @param buffer    The chars being split. They have to outlive the walk and don't have to be null terminated
+ * @param length    How many chars there are
+ * @param splitter  The char that buffer is split by
  */
-void tokenize_move(char *str)
+void tokenizer_init(Tokenizer *tokens, const char *buffer, uintmax_t length, char splitter)
 {
-	int_fast8_t i = 0;
-	while(str[i] != '\0')
-	{
-		if(str[i] == 'x')
-		{
-			string_remove(str, i);
-			i--;
-		}
-		else if(str[i] == '=' || str[i] == '#' || str[i] == '+')
-		{
-			str[i] = '\0';
-			i--;
-		}
-		i++;
-	}
+	tokens->next = buffer;
+	tokens->end = buffer + length;
+	tokens->splitter = splitter;
+}
+
+/**
+ * Finds the next token. Two splitters in a row have an empty token between them, and a
+ * string with no splitters is one token, even if it's empty.
+ *
+ * @param tokens  The walk, as tokenizer_init() started it
+ * @param token   Set to the token. It points into the string being split
+ *
+ * @return false once every token has been handed out
+ */
+bool tokenizer_next(Tokenizer *tokens, Slice *token)
+{
+	const char *end;
+
+	if(tokens->next == NULL) return false;
+
+	for(end = tokens->next; end != tokens->end && *end != tokens->splitter; end++);
+
+	token->str = tokens->next;
+	token->length = end - tokens->next;
+	tokens->next = end == tokens->end ? NULL : end + 1;
+
+	return true;
 }
 
 /**
  * Does a normal string split. Whatever you want ptr to be, it should be initialized like
  * char ptr[x][y];
- * string_split(&ptr[0][0], y, string, splitter). This function assumes you have allocated enough space for anything it does.
+ * string_split(&ptr[0][0], y, string, splitter). There has to be room for every token, but
+ * a token that's y chars or longer is cut short to fit.
  *
  * @param ptr A pointer to the first element of a 2D array of chars
  * @param yWidth The width of the 2nd dimension in the ptr array
@@ -235,72 +253,49 @@ void tokenize_move(char *str)
  */
 uintmax_t string_split(char *ptr, uintmax_t yWidth, const char *string, char splitter)
 {
-	static uintmax_t ptrindex = 0;
+	Tokenizer tokens;
+	Slice token;
+	uintmax_t splits = 0;
 
-	uintmax_t i, j, splits;
-	
-	/* Iterate through the string until terminating character is found */
-	for(i = 0; string[i] != splitter && string[i] != '\0'; i++);
+	tokenizer_init(&tokens, string, string_getlen(string), splitter);
+	while(tokenizer_next(&tokens, &token))
+		slice_copy(ptr + splits++ * yWidth, yWidth, token);
 
-	/* Copy string before or between splitters into ptr */
-	for(j = 0; j < i; j++)
-	{
-		ptr[ptrindex * yWidth + j] = string[j];
-	}
-	ptr[ptrindex++ * yWidth + j] = '\0';
+	return splits;
+}
 
+/**
+ * @param slice  A slice of a larger string
+ * @param str    A null terminated string
+ *
+ * @return true if the slice holds exactly the chars of str
+ */
+bool slice_matches(Slice slice, const char *str)
+{
+	uintmax_t i;
 
-	/* BASE CASE */
-	if(string[i] == '\0')
-	{
-		splits = ptrindex;
-		ptrindex = 0;
-		return splits;
-	}
-	else
-	{
-		return string_split(ptr, yWidth, string + i + 1, splitter);
-	}
+	for(i = 0; i < slice.length; i++)
+		if(str[i] != slice.str[i]) return false;
+
+	return str[i] == '\0';
 }
 
 /**
- * Performs same function as string_split() except it's specifically for
- * dynamically allocated 2D arrays of chars.
- *
- * @param ptr The 2D array that all of this is getting sent to. Just
- *            malloc the 2D array and pass it as is, the arrays within
- *            it will be handled by the function
+ * Copies a slice into a null terminated string, cutting it short if it doesn't fit.
  *
- * @param string The string to be splitted (splut?)
- * @param splitter The char that string will be split by
+ * @param destStr  Where the slice is copied to
+ * @param size     How many chars fit in destStr, the null terminator included
+ * @param slice    The slice being copied
  *
- * @returns the number of splits that the function performed for easy
- *          freeing of memory
+ * @return the length of the copied string
  */
-uintmax_t string_split_malloc(char **ptr, const char *string, char splitter)
+uintmax_t slice_copy(char *destStr, uintmax_t size, Slice slice)
 {
-	static uintmax_t ptrindex = 0;
-
-	uintmax_t i , j, splits;
-	for(i = 0; string[i] != splitter && string[i] != '\0'; i++);
+	uintmax_t i;
 
-	/* Allocate memory and assign values for the char array at this place in memory */
-	ptr[ptrindex] = malloc((i + 1) * sizeof(char));
-	for(j = 0; j < i; j++)
-		ptr[ptrindex][j] = string[j];
+	for(i = 0; i < slice.length && i + 1 < size; i++)
+		destStr[i] = slice.str[i];
+	destStr[i] = '\0';
 
-	ptr[ptrindex][j] = '\0';
-	
-	ptrindex++;
-	
-	if(string[i] == '\0')
-	{
-		splits = ptrindex;
-		ptrindex = 0;
-		return splits;
-	}
-	else
-	{
-		return string_split_malloc(ptr, string + i + 1, splitter);
-	}
+	return i;
 }
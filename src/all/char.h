@@ -5,6 +5,21 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+/* A run of characters inside a larger buffer. It isn't null terminated */
+typedef struct
+{
+	const char *str;
+	uintmax_t length;
+} Slice;
+
+/* Where a walk through a string's tokens is up to, see tokenizer_next() */
+typedef struct
+{
+	const char *next;   /* where the next token starts, NULL once there are no more */
+	const char *end;    /* just past the last char being split */
+	char splitter;
+} Tokenizer;
+
 bool char_is_coord(char);
 bool char_is_digit(char);
 bool char_is_piece(char);
@@ -16,7 +31,6 @@ uintmax_t string_concatenate(char*, const char*);
 void string_remove(char*, const uintmax_t);
 void string_copy(char*, const char*);
 
-void tokenize_move(char*);
 
 void string_tolower(char*);
 bool string_matches(const char*, const char*);
@@ -24,6 +38,11 @@ bool string_matches_end(const char*);
 bool string_contains(const char*, char);
 uintmax_t string_count_occurences_of_char(const char*, char);
 uintmax_t string_split(char*, uintmax_t, const char*, char);
-uintmax_t string_split_malloc(char**, const char*, char);
+
+void tokenizer_init(Tokenizer*, const char*, uintmax_t, char);
+bool tokenizer_next(Tokenizer*, Slice*);
+
+uintmax_t slice_copy(char*, uintmax_t, Slice);
+bool slice_matches(Slice, const char*);
 
 #endif /* CHAR_H_INCLUDED */
@@ -1,8 +1,10 @@
 #ifndef CHESS_H_INCLUDED
 #define CHESS_H_INCLUDED
 
+#include <stddef.h>
 #include <time.h>
 
+#include "bitboard.h"
 #include "piece.h"
 
 #ifdef __WIN32
@@ -14,23 +16,55 @@
 
 typedef struct player Player;
 typedef struct game Game;
+typedef struct status_cache StatusCache;
+
+/* Everything make_move() changes that unmake_move() can't work out from the move itself */
+typedef struct
+{
+	PackedMove move;
+	uint_least64_t hash;
+	uint_least8_t captured;				/* the GAME_PIECE() index of the piece taken, NO_PIECE if there wasn't one */
+	Location enPassant;
+	uint_least8_t castling;
+} Undo;
 
 
 
+/*
+ * Everything before Moves is the position. It doesn't point anywhere, not even into the game
+ * itself, so it can be copied as one block of memory with game_copy_position().
+ */
 struct game
 {
+	Piece White[PIECES_PER_SIDE];
+	Piece Black[PIECES_PER_SIDE];
+	Bitboard occupied[3];				/* index 0 holds every piece, TEAM_WHITE and TEAM_BLACK hold each side's pieces */
+	Bitboard typeBoards[PIECE_TYPES];	/* indexed with TYPE_INDEX() */
+	Bitboard attacked[3];				/* every square each side attacks, indexed like occupied. Index 0 isn't used */
+	uint_least8_t mailbox[64];			/* the GAME_PIECE() index of the piece on each square by location_getindex(), NO_PIECE if it's empty */
+	Location enPassant;					/* the square a pawn skipped over with its last move, 0 if the last move wasn't a double step */
+	uint_least8_t castling;				/* the CASTLE_ flags of every castling right that's left */
+	int_fast8_t toMove;					/* TEAM_WHITE or TEAM_BLACK */
+	uint_least64_t hash;				/* the Zobrist key of the position, see zobrist.c */
+
 	MoveList Moves;
-	Piece *White[PIECES_PER_SIDE];
-	Piece *Black[PIECES_PER_SIDE];
-	Location *pieceLocations[2 * PIECES_PER_SIDE]; 	/* when a piece is captured set it's location to NULL, and when */
-};													/* checking element in this, first check if the element is NULL */
+	StatusCache *statusCache;			/* shared between games and not freed with them, NULL to go without */
+	Undo *undoStack;					/* one record per move played with push_move(), the latest last */
+	uintmax_t undoCount;
+	uintmax_t undoCapacity;
+	bool ownsUndoStack;					/* false while undoStack is the room set aside in the game's own block */
+	double moveTime;					/* how many seconds the last process_move() with MOVE_RUNTIME took */
+};
 
 
 Game *init_game();
+void game_reset(Game*);
+Game *game_clone(const Game*);
+void game_copy_position(Game*, const Game*);
 void free_game(Game*);
+int_fast8_t whose_turn(Game*);
 void print_board(Game*, int_fast8_t);
 void print_pieces(Game*, int_fast8_t);
-bool is_valid_move(Game*, const Piece*, const Location, int_fast8_t);
 
 int_fast16_t process_move(Game*, const char*, int_fast8_t);
 
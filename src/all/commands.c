@@ -1,6 +1,10 @@
 #include "commands.h"
 #include "logichelp.h"
+#include "makemove.h"
 #include "mischelp.h"
+#include "perft.h"
+#include "statuscache.h"
+#include "zobrist.h"
 #include "strings.h"
 
 
@@ -103,6 +107,23 @@ static void changecolor(const char *type, const char *color)
 }
 
 
+/* Drops every castling right whose king or rook isn't on its starting square any more */
+static void drop_lost_castling(Game *board)
+{
+	uint_fast8_t i;
+
+	for(i = 0; i < 4; i++)
+	{
+		const int_fast8_t color = i < 2 ? TEAM_WHITE : TEAM_BLACK;
+		const uint_fast8_t base = color == TEAM_WHITE ? 0 : 56;
+		const Piece *king = piece_on(board, base + 4);
+		const Piece *rook = piece_on(board, i % 2 == 0 ? base + 7 : base);
+
+		if(king == NULL || king->type != PIECE_KING || king->color != color || rook == NULL || rook->type != PIECE_ROOK || rook->color != color)
+			board->castling &= ~(1 << i);
+	}
+}
+
 static void placepiece(Game *board, const char *i, const char *cord)
 {
 	uint_fast8_t index;
@@ -113,46 +134,105 @@ static void placepiece(Game *board, const char *i, const char *cord)
 	index = atoi(i);
 	if(index < 2 * PIECES_PER_SIDE && IS_ON_BOARD(location_getfile(loc), location_getrank(loc)))
 	{
-		int_fast8_t isOn;
-		Piece **arr;
+		Piece *occupant, *arr;
 
-		isOn = piece_is_on(board, loc);
-		if(isOn)
-		{
-			int_fast8_t i, j;
-			Piece *piece;
-			bool match;
-			
-			match = false;
-			for(i = 0; !match && i < 2 * PIECES_PER_SIDE; i++)
-			{
-				j = i % PIECES_PER_SIDE;
-				arr = i >= PIECES_PER_SIDE ? board->Black : board->White;
-				if(loc == arr[j]->currentLocation)
-				{
-					match = true;
-					piece = arr[j];
-				}
-			}
-			capture(board, piece);
-		}
+		occupant = piece_at(board, loc);
+		if(occupant != NULL)
+			capture(board, occupant);
 
 		arr = index < PIECES_PER_SIDE ? board->White : board->Black;
-		arr[index % PIECES_PER_SIDE]->currentLocation = loc;
+		relocate(board, &(arr[index % PIECES_PER_SIDE]), loc);
+		drop_lost_castling(board);
+
+		/* the moves before this can't be taken back from the new position, and its pawns may not be where an en passant square says */
+		board->undoCount = 0;
+		board->enPassant = 0;
+		board->hash = zobrist_compute(board);
 	}
 }
 
+/**
+ * Takes back the latest move and removes it from the move list.
+ */
+static void takeback(Game *board)
+{
+	if(pop_move(board))
+		remove_latest_move(&(board->Moves));
+}
+
+/**
+ * Runs perft (or divide) on the current position and waits for enter
+ * so the result can be read before the board is redrawn.
+ */
+static void runperft(Game *board, const char *depth, bool split)
+{
+	char dummy[3];
+	const int d = atoi(depth);
+
+	if(d < 0 || d > 10) return;
+
+	if(split)
+		divide(board, whose_turn(board), d);
+	else
+	{
+		clock_t start = clock();
+		uintmax_t nodes = perft(board, whose_turn(board), d);
+		double seconds = ((double) (clock() - start)) / CLOCKS_PER_SEC;
+
+		printf("perft %d: %" PRIuMAX " nodes in %.3lfs", d, nodes, seconds);
+		if(seconds > 0) printf(" (%.0lf nodes/s)", nodes / seconds);
+		printf("\n");
+	}
+
+	fgets(dummy, 3, stdin);
+}
+
+/**
+ * Prints how often the check and mate status of a position was already known
+ * and waits for enter so it can be read before the board is redrawn.
+ */
+static void cachestats(Game *board)
+{
+	char dummy[3];
+	const StatusCache *cache = board->statusCache;
+
+	if(cache == NULL) return;
+
+	printf("status cache: %" PRIuMAX " hits, %" PRIuMAX " misses, %" PRIuMAX " entries\n", cache->hits, cache->misses, cache->mask + 1);
+
+	fgets(dummy, 3, stdin);
+}
+
 void command(Game* board, const char *str)
 {
 	const uint_fast8_t words = 5;
 	const uint_fast8_t wordLength = 20;
 
 	char tokens[words][wordLength];
-	int_fast8_t tokenslen = string_split(&tokens[0][0], wordLength, str, ' ');
+	uint_fast8_t tokenslen = 0;
+	Tokenizer split;
+	Slice word;
+
+	tokenizer_init(&split, str, string_getlen(str), ' ');
+	while(tokenizer_next(&split, &word))
+	{
+		/* None of the commands take that many words */
+		if(tokenslen == words) return;
+
+		slice_copy(tokens[tokenslen++], wordLength, word);
+	}
 
 
 	if(tokenslen == 3 && string_matches(tokens[0], "changecolor"))
 		changecolor(tokens[1], tokens[2]);
 	else if(tokenslen == 3 && string_matches(tokens[0], "place"))
 		placepiece(board, tokens[1], tokens[2]);
+	else if(tokenslen == 2 && string_matches(tokens[0], "perft"))
+		runperft(board, tokens[1], false);
+	else if(tokenslen == 2 && string_matches(tokens[0], "divide"))
+		runperft(board, tokens[1], true);
+	else if(tokenslen == 1 && (string_matches(tokens[0], "takeback") || string_matches(tokens[0], "undo")))
+		takeback(board);
+	else if(tokenslen == 1 && string_matches(tokens[0], "cache"))
+		cachestats(board);
 }
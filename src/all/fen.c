@@ -0,0 +1,203 @@
+#include "fen.h"
+#include "logichelp.h"
+#include "zobrist.h"
+
+typedef struct
+{
+	uint_fast8_t type;
+	Location loc;
+} Placement;
+
+/**
+ * Picks the first free slot out of two preferred ones.
+ *
+ * @return the slot, or PIECES_PER_SIDE if neither is free
+ */
+static uint_fast8_t take_slot(bool *used, uint_fast8_t first, uint_fast8_t second)
+{
+	uint_fast8_t ret = PIECES_PER_SIDE;
+
+	if(!used[first])
+		ret = first;
+	else if(!used[second])
+		ret = second;
+
+	if(ret != PIECES_PER_SIDE) used[ret] = true;
+
+	return ret;
+}
+
+/**
+ * Puts one side's pieces into that side's piece array. Pawns go into the pawn slots, the king
+ * into I_KING, and rooks on their starting squares into I_ROOK1 and I_ROOK2 so castling finds
+ * them. Everything else takes its usual slot if it can, or any slot left over (e.g. a second queen).
+ *
+ * @return false if the pieces don't fit
+ */
+static bool place_side(Game *board, Piece *team, const Placement *placements, uint_fast8_t count, uint_fast8_t base)
+{
+	bool used[PIECES_PER_SIDE], fits;
+	uint_fast8_t slots[PIECES_PER_SIDE], i, j, pawns, kings;
+
+	for(i = 0; i < PIECES_PER_SIDE; i++)
+		used[i] = false;
+
+	pawns = kings = 0;
+	fits = true;
+
+	/* First pass: the pieces with a slot they have to be in */
+	for(i = 0; fits && i < count; i++)
+	{
+		const Placement *pl = &placements[i];
+
+		slots[i] = PIECES_PER_SIDE;
+
+		if(pl->type == PIECE_PAWN)
+		{
+			fits = pawns < 8;
+			slots[i] = I_PAWN1 + pawns++;
+		}
+		else if(pl->type == PIECE_KING)
+		{
+			fits = kings++ == 0;
+			slots[i] = I_KING;
+		}
+		else if(pl->type == PIECE_ROOK && location_getrank(pl->loc) == base && (location_getfile(pl->loc) == 1 || location_getfile(pl->loc) == 8))
+			slots[i] = location_getfile(pl->loc) == 1 ? I_ROOK1 : I_ROOK2;
+
+		if(slots[i] != PIECES_PER_SIDE) used[slots[i]] = true;
+	}
+
+	/* Second pass: everything else */
+	for(i = 0; fits && i < count; i++)
+	{
+		const Placement *pl = &placements[i];
+
+		if(slots[i] != PIECES_PER_SIDE) continue;
+
+		switch(pl->type)
+		{
+			case PIECE_QUEEN:
+				slots[i] = take_slot(used, I_QUEEN, I_QUEEN);
+				break;
+			case PIECE_ROOK:
+				slots[i] = take_slot(used, I_ROOK1, I_ROOK2);
+				break;
+			case PIECE_KNIGHT:
+				slots[i] = take_slot(used, I_KNIGHT1, I_KNIGHT2);
+				break;
+			case PIECE_BISHOP:
+				slots[i] = take_slot(used, I_BISHOP1, I_BISHOP2);
+				break;
+		}
+
+		for(j = 0; slots[i] == PIECES_PER_SIDE && j < PIECES_PER_SIDE; j++)
+			slots[i] = take_slot(used, j, j);
+
+		fits = slots[i] != PIECES_PER_SIDE;
+	}
+
+	for(i = 0; fits && i < count; i++)
+	{
+		Piece *p = &(team[slots[i]]);
+
+		retype(board, p, placements[i].type);
+		relocate(board, p, placements[i].loc);
+	}
+
+	return fits && kings == 1;
+}
+
+/**
+ * Sets up a game from a position in Forsyth-Edwards Notation
+ * (https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation). The move
+ * counters at the end of the string are ignored.
+ *
+ * @param board  The game being set up. Its moves are cleared along with the position, so
+ *               they can't be taken back afterwards
+ * @param fen    The position
+ *
+ * @return the color whose turn it is in the position, or 0 if fen couldn't be read
+ */
+int_fast8_t load_fen(Game *board, const char *fen)
+{
+	Placement white[PIECES_PER_SIDE], black[PIECES_PER_SIDE];
+	uint_fast8_t whiteCount, blackCount, i, h, v;
+	int_fast8_t ret;
+	bool ok;
+
+	for(i = 0; i < PIECES_PER_SIDE; i++)
+	{
+		capture(board, &(board->White[i]));
+		capture(board, &(board->Black[i]));
+	}
+	board->enPassant = 0;
+	board->castling = 0;
+	board->undoCount = 0;
+	clear_move_list(&(board->Moves));
+
+	whiteCount = blackCount = 0;
+	h = 1;
+	v = 8;
+	ok = true;
+	for(; ok && *fen != ' ' && *fen != '\0'; fen++)
+	{
+		if(*fen == '/')
+		{
+			ok = h == 9;
+			h = 1;
+			v--;
+		}
+		else if(*fen > '0' && *fen < '9')
+			h += *fen - '0';
+		else
+		{
+			const bool isWhite = *fen >= 'A' && *fen <= 'Z';
+			const char symbol = isWhite ? *fen : *fen - 32;
+			Placement *pl;
+
+			ok = IS_ON_BOARD(h, v) && (isWhite ? whiteCount : blackCount) < PIECES_PER_SIDE && (symbol == 'P' || char_is_piece(symbol));
+			if(ok)
+			{
+				pl = isWhite ? &white[whiteCount++] : &black[blackCount++];
+
+				pl->type = piece_type_from_symbol(symbol);
+				location_assign(&(pl->loc), h++, v);
+			}
+		}
+	}
+	ok = ok && v == 1 && h == 9;
+
+	ok = ok && place_side(board, board->White, white, whiteCount, 1) && place_side(board, board->Black, black, blackCount, 8);
+
+	ret = 0;
+	if(ok && fen[0] == ' ' && (fen[1] == 'w' || fen[1] == 'b'))
+	{
+		ret = fen[1] == 'w' ? TEAM_WHITE : TEAM_BLACK;
+		fen += 2;
+	}
+
+	/* Castling rights. Any right that isn't there means the king or rook has already moved */
+	if(ret != 0 && *fen == ' ')
+	{
+		for(fen++; *fen != ' ' && *fen != '\0'; fen++)
+		{
+			Piece *team = *fen == 'K' || *fen == 'Q' ? board->White : board->Black;
+			Piece *rook = &(team[*fen == 'K' || *fen == 'k' ? I_ROOK2 : I_ROOK1]);
+			const uint_fast8_t file = rook == &(team[I_ROOK2]) ? 8 : 1;
+			const uint_fast8_t rank = team == board->White ? 1 : 8;
+
+			if(string_contains("KQkq", *fen) && rook->type == PIECE_ROOK && location_equals_coords(rook->currentLocation, file, rank) &&
+			   location_equals_coords(team[I_KING].currentLocation, 5, rank))
+				board->castling |= (rook == &(team[I_ROOK2]) ? CASTLE_WHITE_KINGSIDE : CASTLE_WHITE_QUEENSIDE) << (team == board->White ? 0 : 2);
+		}
+	}
+
+	if(ret != 0 && *fen == ' ' && char_is_coord(fen[1]) && char_is_digit(fen[2]))
+		location_assign(&(board->enPassant), fen[1] - 96, fen[2] - '0');
+
+	if(ret != 0) board->toMove = ret;
+	board->hash = zobrist_compute(board);
+
+	return ret;
+}
@@ -0,0 +1,8 @@
+#ifndef FEN_H_INCLUDED
+#define FEN_H_INCLUDED
+
+#include "chess.h"
+
+int_fast8_t load_fen(Game*, const char*);
+
+#endif /* FEN_H_INCLUDED */
@@ -1,174 +1,405 @@
+#define _POSIX_C_SOURCE 200112L    /* for fileno(), fstat() and mmap() */
+
 #include "filereading.h"
 
+#ifdef PGN_CAN_MAP
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+/*
+ * A PGN file is read in one pass. A regular file is mapped into memory as one read-only
+ * buffer, so opening it reads nothing and only the pages that are walked are ever loaded.
+ * Anything that can't be mapped, like a pipe or a terminal, is read PGN_BUFFER_SIZE chars
+ * at a time instead. Tag pairs, comments and move numbers are skipped as they go by, and
+ * every move is handed out as a slice of the buffer, so nothing is copied or allocated per
+ * move and each char of the file is looked at once.
+ */
+
+/*
+ * Maps the rest of the file fp reads from into memory. Returns false if it isn't a
+ * regular file or there's nothing left in it, and then the reader has to read it instead.
+ */
+static bool pgn_map(PGNReader *reader, FILE *fp)
+{
+#ifdef PGN_CAN_MAP
+	struct stat st;
+	long offset;
+	void *map;
+
+	if(fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+
+	/* stdio may have read ahead of where the stream is, so this is where the reader starts */
+	offset = ftell(fp);
+	if(offset < 0 || (uintmax_t) offset >= (uintmax_t) st.st_size) return false;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+	if(map == MAP_FAILED) return false;
+
+	posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+	reader->mapped = true;
+	reader->buffer = map;
+	reader->pos = offset;
+	reader->length = st.st_size;
+	reader->mapLength = st.st_size;
+	reader->base = 0;
+	reader->remaining = 0;
+	reader->bytes = st.st_size - offset;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
 /**
- * Wrapper for file opening so that a readable assertion pops up if the
- * entered filename doesn't exist.
+ * Opens a PGN file for reading.
  *
- * @param filename Name of the file to open in string format
+ * @param reader    The reader being set up
+ * @param filename  Name of the file to open, or - for stdin
  *
- * @return A FILE object to do read operations on
+ * @return false if the file couldn't be opened
  */
-static FILE *file_open(const char *filename)
+bool pgn_open(PGNReader *reader, const char *filename)
 {
 	FILE *fp;
-	bool FILE_DOESNT_EXIST;
 
+	if(string_matches(filename, "-"))
+	{
+		pgn_from_stream(reader, stdin, true);
+		return true;
+	}
 
 	fp = fopen(filename, "r");
 
-	FILE_DOESNT_EXIST = fp != NULL;
-	assert(FILE_DOESNT_EXIST);
+	if(fp == NULL) return false;
 
-	return fp;
+	pgn_from_stream(reader, fp, true);
+	reader->ownsFile = true;
+
+	return true;
 }
 
 /**
- * Wrapper for the fgetc function so that it returns 0 if the end 
- * of the file is reached.
+ * Sets up a reader on a stream that's already open, e.g. stdin. pgn_close() won't close it.
  *
- * @param stream A FILE object to read from
- *
- * @return The read character
+ * @param reader  The reader being set up
+ * @param fp      The stream the PGN is read from
+ * @param map     Whether to map the file into memory if it can be. If false, or if it's
+ *                something like a pipe, it's read through a buffer instead
  */
-static char my_fgetc(FILE *stream)
+void pgn_from_stream(PGNReader *reader, FILE *fp, bool map)
 {
-	char ret = fgetc(stream);
-	if(feof(stream)) ret = 0;
-
-	return ret;
+	reader->fp = fp;
+	reader->ownsFile = false;
+	reader->tags = false;
+
+	if(map && pgn_map(reader, fp)) return;
+
+	reader->mapped = false;
+	reader->buffer = malloc(PGN_BUFFER_SIZE * sizeof(char));
+	assert(reader->buffer != NULL);
+	reader->pos = 0;
+	reader->length = 0;
+	reader->mapLength = 0;
+	reader->base = ftell(fp) < 0 ? 0 : ftell(fp);
+	reader->remaining = UINTMAX_MAX;
+	reader->bytes = 0;
 }
 
 /**
- * The file pointer iterates through the file unti it
- * reaches the char c.
+ * Opens part of a PGN file for reading, e.g. one game out of many.
  *
- * @param fp The FILE object to read from
- * @param c The character to stop at
+ * @param reader    The reader being set up
+ * @param filename  Name of the file to open
+ * @param offset    Where in the file reading starts
+ * @param length    How many chars are read from there
  *
- * @return The character the file pointer stopped at
+ * @return false if the file couldn't be opened
  */
-static char advance_file_pointer_until(FILE *fp, char c)
+bool pgn_open_range(PGNReader *reader, const char *filename, uintmax_t offset, uintmax_t length)
 {
-	char getGot;
+	if(!pgn_open(reader, filename)) return false;
 
-	do
+	if(!pgn_seek(reader, offset, length))
 	{
-    		getGot = my_fgetc(fp);
-	} while(getGot != c && getGot != 0);
+		pgn_close(reader);
+		return false;
+	}
 
-    return getGot;
+	return true;
 }
 
-uintmax_t count_occurences_of_char_in_file(char c, const char *filename)
+/**
+ * Moves a reader to another part of its file, so that one reader can read many games out
+ * of the same file without opening it again for each.
+ *
+ * @param reader  A reader on a file, not a stream like stdin
+ * @param offset  Where in the file reading starts
+ * @param length  How many chars are read from there
+ *
+ * @return false if the file couldn't be moved to offset
+ */
+bool pgn_seek(PGNReader *reader, uintmax_t offset, uintmax_t length)
 {
-	FILE *fp = file_open(filename);
-	uintmax_t count;
-	char current;
+	if(reader->mapped)
+	{
+		if(offset > reader->mapLength) offset = reader->mapLength;
+		if(length > reader->mapLength - offset) length = reader->mapLength - offset;
 
-	count = 0;
+		reader->pos = offset;
+		reader->length = offset + length;
+		reader->bytes = length;
 
-	do
-	{
-		current = my_fgetc(fp);
+		return true;
+	}
 
-		if(current == c) count++;
-	} while(current != 0);
+	if(fseek(reader->fp, offset, SEEK_SET) != 0) return false;
 
-	fclose(fp);
+	reader->pos = 0;
+	reader->length = 0;
+	reader->base = offset;
+	reader->remaining = length;
 
-	return count;
+	return true;
 }
 
-static uintmax_t get_length_of_file(const char *filename)
+void pgn_close(PGNReader *reader)
 {
-	FILE *fp = file_open(filename);
-	uintmax_t count;
-	char current;
+#ifdef PGN_CAN_MAP
+	if(reader->mapped)
+		munmap(reader->buffer, reader->mapLength);
+	else
+#endif
+		free(reader->buffer);
+
+	if(reader->ownsFile) fclose(reader->fp);
+}
 
-	count = 0;
+/*
+ * Reads the next part of the file into the buffer. The chars from keep onwards are the start of
+ * a token that isn't finished yet, so they're moved to the front of the buffer first. keep is
+ * updated to where they ended up.
+ *
+ * Returns false if there was nothing left to read or no room to read it into.
+ */
+static bool pgn_refill(PGNReader *reader, uintmax_t *keep)
+{
+	uintmax_t kept = 0, got;
 
-	for(current = my_fgetc(fp); current != 0; current = my_fgetc(fp))
-		count++;
+	if(reader->mapped) return false;	/* the whole file is already there */
 
-	return count;
+	if(keep != NULL)
+	{
+		kept = reader->length - *keep;
+		memmove(reader->buffer, reader->buffer + *keep, kept);
+		reader->base += *keep;
+		*keep = 0;
+	}
+	else
+		reader->base += reader->length;
+
+	if(kept == PGN_BUFFER_SIZE) return false;
+
+	got = PGN_BUFFER_SIZE - kept < reader->remaining ? PGN_BUFFER_SIZE - kept : reader->remaining;
+	got = fread(reader->buffer + kept, sizeof(char), got, reader->fp);
+	reader->pos = kept;
+	reader->length = kept + got;
+	reader->remaining -= got;
+	reader->bytes += got;
+
+	return got > 0;
 }
 
-static uintmax_t get_length_of_file_moves(const char *filename)
+/**
+ * Finds the next move in a PGN file. Tag pairs ([...]), comments ({...} and ; to the end
+ * of the line), move numbers, NAGs ($1) and variations ((...), however deeply nested) are
+ * skipped. The result at the end of a game (1-0, 0-1,
+ * 1/2-1/2 or *) comes out as a token like a move. If the reader's tags field is set, tag
+ * pairs come out as tokens too, brackets included.
+ *
+ * @param reader  The reader the file is being read with
+ * @param token   Set to the move. It points into the reader's buffer and is only good
+ *                until the next call
+ *
+ * @return false once the end of the file has been reached
+ */
+bool pgn_next_token(PGNReader *reader, Slice *token)
 {
-	FILE *fp = file_open(filename);
-	uintmax_t count;
-	char current;
-
-	count = 0;
+	/* Kept in locals so the loop doesn't have to go back to the reader for every char */
+	const char *buffer = reader->buffer;
+	uintmax_t pos = reader->pos, length = reader->length, start = 0, depth = 0;
+	bool inToken = false, inNag = false;
+	char skipUntil = '\0';
 
-	do
+	for(;; pos++)
 	{
-		current = my_fgetc(fp);
+		char c;
+
+		if(pos == length)
+		{
+			reader->pos = pos;
+			if(!pgn_refill(reader, inToken ? &start : NULL)) break;
 
-		if(current == '{' || current == '[')
-			current = advance_file_pointer_until(fp, current + 2);
-		else if(current == ';')
-			current = advance_file_pointer_until(fp, '\n');
-		else if(current != '.' && current > 31 && current < 126)
-			count++;
-	} while(current != 0);
+			buffer = reader->buffer;
+			pos = reader->pos;
+			length = reader->length;
+		}
 
-	return count;
-}
+		c = buffer[pos];
 
-void readfile(const char *filename, char *destStr)
-{
-	char current;
-	FILE *fp = file_open(filename);
+		if(skipUntil != '\0')
+		{
+			if(c == skipUntil)
+			{
+				skipUntil = '\0';
+
+				/* The tag pair is over, brackets and all */
+				if(inToken)
+				{
+					pos++;
+					break;
+				}
+			}
+		}
+		else if(c <= ' ' || c == '{' || c == '[' || c == ';' || c == '(' || c == ')' || c == '$')
+		{
+			if(inToken) break;
+
+			inNag = c == '$';
+
+			if(c == '{')
+				skipUntil = '}';
+			else if(c == '[')
+			{
+				skipUntil = ']';
+
+				if(reader->tags && depth == 0)
+				{
+					start = pos;
+					inToken = true;
+				}
+			}
+			else if(c == ';')
+				skipUntil = '\n';
+			else if(c == '(')
+				depth++;
+			else if(c == ')' && depth > 0)
+				depth--;
+		}
+		else if(inNag || depth > 0)
+			continue;	/* the digits of a NAG, or a move in a variation */
+		else if(c == '.')
+			inToken = false;	/* everything up to here was a move number */
+		else if(!inToken)
+		{
+			start = pos;
+			inToken = true;
+		}
+	}
 
-	do
+	reader->pos = pos;
+
+	if(inToken)
 	{
-		current = my_fgetc(fp);
+		token->str = buffer + start;
+		token->length = pos - start;
+	}
 
-		if(current == '\n') current = ' ';
+	return inToken;
+}
 
-		if(current > 31 && current < 126)
-		{
-			uintmax_t i;
-
-			if(current == '{' || current == '[')
-				current = advance_file_pointer_until(fp, current + 2);
-			else if(current == ';')
-				current = advance_file_pointer_until(fp, '\n');
-			else if(current == '.')
-				for(i = string_getlen(destStr) - 1; destStr[i] != ' '; i--)
-					string_remove(destStr, i);
-			else if(current != ' ' || (string_getlen(destStr) > 0 && destStr[string_getlen(destStr) - 1] != ' '))
-				string_add_char(destStr, current);
-    	}
-	} while(current != 0);
-
-/*    printf("\n\n"); */
+/**
+ * @param reader  The reader the file is being read with
+ * @param str     A char in the reader's buffer, e.g. the start of a token
+ *
+ * @return where in the file str was read from
+ */
+uintmax_t pgn_offset(const PGNReader *reader, const char *str)
+{
+	return reader->base + (str - reader->buffer);
+}
 
-	fclose(fp);
+/* Writes a made up collection of games to a temporary file, until it's at least PGN_BENCHMARK_BYTES long */
+static FILE *pgn_benchmark_file()
+{
+	const char *GAME =
+		"[Event \"Benchmark\"]\n"
+		"[Site \"?\"]\n"
+		"[White \"Morphy, Paul\"]\n"
+		"[Black \"Duke Karl / Count Isouard\"]\n"
+		"[Result \"1-0\"]\n\n"
+		"1. e4 e5 2. Nf3 d6 3. d4 Bg4 {This is a weak move already.} 4. dxe5 Bxf3 5. Qxf3 dxe5\n"
+		"6. Bc4 Nf6 7. Qb3 Qe7 8. Nc3 c6 9. Bg5 b5 10. Nxb5 cxb5 11. Bxb5+ Nbd7 12. O-O-O Rd8\n"
+		"13. Rxd7 Rxd7 14. Rd1 Qe6 15. Bxd7+ Nxd7 16. Qb8+ Nxb8 17. Rd8# ; The opera game\n"
+		"1-0\n\n";
+	FILE *fp = tmpfile();
+	uintmax_t written;
+
+	assert(fp != NULL);
+
+	for(written = 0; written < PGN_BENCHMARK_BYTES; written += string_getlen(GAME))
+		fputs(GAME, fp);
+
+	rewind(fp);
+
+	return fp;
 }
 
-char **get_moves_from_file(const char *filename, uintmax_t *size)
+/* Reads every token from fp and prints how long it took */
+static void pgn_time(FILE *fp, bool map)
 {
-	uintmax_t filelen, numOfSpaces;
-	char *tempstr, **retStr;
+	PGNReader reader;
+	Slice token;
+	uintmax_t tokens;
+	clock_t start;
+	double seconds;
 
-	filelen = get_length_of_file_moves(filename);
-/*    printf("\n\nfilelen = %" PRIuMAX "\n", filelen); */
+	rewind(fp);
 
-	tempstr = malloc(filelen * sizeof(char));
-	tempstr[0] = '\0';
+	tokens = 0;
+	start = clock();
 
-	readfile(filename, tempstr);
-	assert(string_getlen(tempstr) <= filelen);
+	pgn_from_stream(&reader, fp, map);
+	while(pgn_next_token(&reader, &token))
+		tokens++;
 
-	numOfSpaces = string_count_occurences_of_char(tempstr, ' ');
+	seconds = ((double) (clock() - start)) / CLOCKS_PER_SEC;
 
-	retStr = malloc((numOfSpaces + 1) * sizeof(char *));
-	*size = string_split_malloc(retStr, tempstr, ' ');
+	printf("%-9s %" PRIuMAX " bytes, %" PRIuMAX " tokens in %.3lfs", reader.mapped ? "mapped:" : "buffered:", reader.bytes, tokens, seconds);
+	if(seconds > 0) printf(" (%.1lf MB/s, %.0lf tokens/s)", reader.bytes / seconds / (1 << 20), tokens / seconds);
+	printf("\n");
 
+	pgn_close(&reader);
+}
 
-	free(tempstr);
+/**
+ * Times how fast the moves of a PGN file can be read, both mapped into memory and through
+ * a buffer, and prints how many bytes and tokens a second that comes to.
+ *
+ * @param filename  The file to read, or NULL to make one up that's PGN_BENCHMARK_BYTES long
+ */
+void pgn_benchmark(const char *filename)
+{
+	FILE *fp;
+
+	if(filename != NULL)
+	{
+		bool FILE_DOESNT_EXIST;
 
-	return retStr;
+		fp = fopen(filename, "r");
+		FILE_DOESNT_EXIST = fp != NULL;
+		assert(FILE_DOESNT_EXIST);
+	}
+	else
+	{
+		printf("Writing %" PRIuMAX " MB of games to a temporary file...\n", (uintmax_t) PGN_BENCHMARK_BYTES >> 20);
+		fp = pgn_benchmark_file();
+	}
+
+	pgn_time(fp, true);
+	pgn_time(fp, false);
+
+	fclose(fp);
 }
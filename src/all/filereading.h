@@ -4,14 +4,42 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "char.h"
+#include "macros.h"
 
-uintmax_t count_occurences_of_char_in_file(char, const char*);
+#if defined(__unix__) || defined(__APPLE__)
+	#define PGN_CAN_MAP 1   /* regular files are memory-mapped instead of read */
+#endif
 
-char **get_moves_from_file(const char*, uintmax_t*);
+/* Reads the moves out of a PGN file one token at a time, see pgn_next_token() */
+typedef struct
+{
+	FILE *fp;
+	bool ownsFile;      /* false for a stream such as stdin that pgn_close() leaves open */
+	bool mapped;        /* true if buffer is the whole file mapped into memory */
+	bool tags;          /* true to hand out tag pairs as tokens instead of skipping them */
+	char *buffer;       /* the whole file if it's mapped, otherwise PGN_BUFFER_SIZE chars of it */
+	uintmax_t pos;      /* the next char to look at */
+	uintmax_t length;   /* how much of buffer is read, or where reading stops if it's mapped */
+	uintmax_t mapLength;/* the size of the mapping */
+	uintmax_t base;     /* where in the file buffer starts */
+	uintmax_t remaining;/* how much more of the file is read if it isn't mapped */
+	uintmax_t bytes;    /* how much of the file has been put in buffer so far */
+} PGNReader;
 
-void readfile(const char*, char*);
+bool pgn_open(PGNReader*, const char*);
+bool pgn_open_range(PGNReader*, const char*, uintmax_t, uintmax_t);
+bool pgn_seek(PGNReader*, uintmax_t, uintmax_t);
+void pgn_from_stream(PGNReader*, FILE*, bool);
+void pgn_close(PGNReader*);
+
+bool pgn_next_token(PGNReader*, Slice*);
+uintmax_t pgn_offset(const PGNReader*, const char*);
+
+void pgn_benchmark(const char*);
 
 
 #endif /* FILEREADING_H_INCLUDED */
@@ -82,3 +82,30 @@ void location_assign(Location *loc, uint_fast8_t x, uint_fast8_t y)
 	location_setrank(loc, y);
 }
 
+/**
+ * Converts a location into a square index from 0 (a1) to 63 (h8), counting
+ * along the ranks. This is the index used for bitboards.
+ *
+ * @param loc The location being converted. Must be on the board
+ *
+ * @returns the square index of loc
+ */
+uint_fast8_t location_getindex(Location loc)
+{
+	return (location_getrank(loc) - 1) * 8 + location_getfile(loc) - 1;
+}
+
+/**
+ * The inverse of location_getindex().
+ *
+ * @param index A square index from 0 to 63
+ *
+ * @returns the location of that square
+ */
+Location location_from_index(uint_fast8_t index)
+{
+	Location ret;
+	location_assign(&ret, (index % 8) + 1, (index / 8) + 1);
+
+	return ret;
+}
@@ -19,4 +19,7 @@ void location_to_coordinate_string(char*, Location);
 
 void location_assign(Location*, uint_fast8_t, uint_fast8_t);
 
+uint_fast8_t location_getindex(Location);
+Location location_from_index(uint_fast8_t);
+
 #endif /* LOCATION_H_INCLUDED */
@@ -1,200 +1,249 @@
 #include "logichelp.h"
+#include "attacks.h"
+#include "movegen.h"
+#include "statuscache.h"
+#include "zobrist.h"
 
-/**
- * Captures piece i.e. frees the location of the piece and
- * sets it to NULL.
- *
- * @param board The game currently being played
- * @param p The piece being captured
- * @param index The index of the piece in the board's pieceLocations array
- */
-void capture(Game *board, Piece *p)
+/* The squares a piece on the board attacks, given every occupied square */
+static Bitboard piece_attacks(const Piece *p, Bitboard occupancy)
 {
-	int_fast8_t i = (p->color - 1) * 16;
-	while(i < 2 * PIECES_PER_SIDE && 
-		  (board->pieceLocations[i] == 0 || ( board->pieceLocations[i] != 0 && *(board->pieceLocations[i]) != p->currentLocation ) ))
-		i++;
+	const uint_fast8_t index = location_getindex(p->currentLocation);
 
+	switch(p->type)
+	{
+		case PIECE_PAWN:
+			return PAWN_ATTACKS[p->color - 1][index];
+		case PIECE_KNIGHT:
+			return KNIGHT_ATTACKS[index];
+		case PIECE_BISHOP:
+			return bishop_attacks(index, occupancy);
+		case PIECE_ROOK:
+			return rook_attacks(index, occupancy);
+		case PIECE_QUEEN:
+			return queen_attacks(index, occupancy);
+		case PIECE_KING:
+			return KING_ATTACKS[index];
+	}
 
-	p->currentLocation = 0;
+	return BB_EMPTY;
 }
 
-/**
- * Reverses a capture if the move was invalid.
- *
- * @param board      The Game instance being played
- * @param p          The piece being uncaptured
- * @param index      The index of p in its color array
- * @param coords     The coordinates that p is going to get
+/*
+ * Brings the attack sets up to date once p has moved and the squares in changed have been
+ * emptied or filled. Only a slider that reaches one of those squares can see a difference,
+ * so the other pieces keep the attacks they have. The attack map of each side with a piece
+ * whose attacks changed is then rebuilt as the union of its pieces' attacks.
  */
-void uncapture(Game *board, Piece *p, uint_fast8_t index, Location coords)
+static void update_attacks(Game *board, Piece *p, Bitboard changed)
 {
-	uint_fast8_t realindex = (p->color - 1) * 16 + index;
+	const Bitboard *types = board->typeBoards;
+	Bitboard sliders;
+	uint_fast8_t color, dirty;
 
-	assert(p->currentLocation == 0);
-	assert(*(board->pieceLocations[realindex]) == 0);
+	p->attacks = p->currentLocation != 0 ? piece_attacks(p, board->occupied[0]) : BB_EMPTY;
+	dirty = p->color;	/* TEAM_WHITE and TEAM_BLACK are different bits, so they work as flags */
 
-	p->currentLocation = coords;
-}
-
-/**
- * Deduces if there is a piece residing on the given location.
- *
- * @param board The game instance being played
- * @param loc The location being tested
- *
- * @return 0 if there is no piece on the board, TEAM_WHITE if
- *           there is a white piece on the board, or TEAM_BLACK
- *           if there is a black piece on the board
- */
-int_fast8_t piece_is_on(Game *board, const Location loc)
-{
-	int_fast8_t ret = 0;
+	sliders = types[TYPE_INDEX(PIECE_BISHOP)] | types[TYPE_INDEX(PIECE_ROOK)] | types[TYPE_INDEX(PIECE_QUEEN)];
+	for(; sliders != BB_EMPTY; sliders &= sliders - 1)
+	{
+		const uint_fast8_t index = board->mailbox[bitboard_first(sliders)];
+		Piece *q = GAME_PIECE(board, index);
 
-	Location **locs = board->pieceLocations;
+		if(q != p && (q->attacks & changed))
+		{
+			const Bitboard attacks = piece_attacks(q, board->occupied[0]);
 
-	uint_fast8_t h = location_getfile(loc);
-	uint_fast8_t v = location_getrank(loc);
+			if(attacks != q->attacks) dirty |= q->color;
+			q->attacks = attacks;
+		}
+	}
 
-	uint_fast8_t i;
-	for(i = 0; IS_ON_BOARD(h, v) && i < 2 * PIECES_PER_SIDE; i++)
+	for(color = TEAM_WHITE; color <= TEAM_BLACK; color++)
 	{
-		/* if the piece is on the board and its coordinates match loc's */
-		if(locs[i] != 0 && location_equals_coords(*(locs[i]), h, v))
+		Bitboard pieces;
+
+		if(!(dirty & color)) continue;
+
+		board->attacked[color] = BB_EMPTY;
+		for(pieces = board->occupied[color]; pieces != BB_EMPTY; pieces &= pieces - 1)
 		{
-			ret = i < PIECES_PER_SIDE ? TEAM_WHITE : TEAM_BLACK;
-			break;
+			const uint_fast8_t index = board->mailbox[bitboard_first(pieces)];
+
+			board->attacked[color] |= GAME_PIECE(board, index)->attacks;
 		}
 	}
-
-	return ret;
 }
 
 /**
- * With the given information, determines if there are any chess pieces between two locations.
+ * Moves a piece to a new location and keeps the game's bitboards, mailbox, attack maps and key up to date.
+ * This is the only place a piece's location should be changed once the game
+ * has been initialized.
  *
- * @param board    The current game instance being played
- * @param oldLoc   The starting point for the function's analysis
- * @param newLoc   The ending point of the analysis
- * @param xInc     The value the horizontal axis is being incremented by each iteration
- * @param yInc     The value the vertical axis is being incremented by each iteration
- *
- * @return         True if a piece was anywhere between oldLoc and newLoc. False otherwise
+ * @param board The game currently being played
+ * @param p     The piece being moved
+ * @param loc   The piece's new location, or 0 to take it off the board
  */
-bool path_is_blocked(Game *board, const Location oldLoc, const Location newLoc, const int_fast8_t xInc, const int_fast8_t yInc) /* Mainly used for bishops, rooks, queens */
+void relocate(Game *board, Piece *p, Location loc)
 {
-	bool blocked = false;
+	const uint_fast8_t type = TYPE_INDEX(p->type);
+	const uint_least64_t *keys = ZOBRIST_PIECES[p->color - 1][type];
+	Bitboard changed = BB_EMPTY;
+
+	if(p->currentLocation != 0)
+	{
+		const Bitboard old = BB_LOCATION(p->currentLocation);
+
+		board->hash ^= keys[location_getindex(p->currentLocation)];
+		changed |= old;
+
+		board->occupied[0] &= ~old;
+		board->occupied[p->color] &= ~old;
+		board->typeBoards[type] &= ~old;
+		board->mailbox[location_getindex(p->currentLocation)] = NO_PIECE;
+	}
 
-	int_fast8_t x;
-	int_fast8_t y;
+	p->currentLocation = loc;
 
-	for(x=location_getfile(oldLoc) + xInc, y=location_getrank(oldLoc) + yInc; x!=location_getfile(newLoc) || y!=location_getrank(newLoc); x+=xInc, y+=yInc)
+	if(loc != 0)
 	{
-		Location temp;
-		location_assign(&temp, x, y);
+		const Bitboard new = BB_LOCATION(loc);
 
-		if(piece_is_on(board, temp))
-		{
-			blocked = true;
-			break;
-		}
+		board->hash ^= keys[location_getindex(loc)];
+		changed |= new;
+
+		board->occupied[0] |= new;
+		board->occupied[p->color] |= new;
+		board->typeBoards[type] |= new;
+		board->mailbox[location_getindex(loc)] = PIECE_INDEX(board, p);
 	}
 
-	return blocked;
+	update_attacks(board, p, changed);
 }
 
-static bool check_if_mate(Game *board, Piece **team)
+/**
+ * Changes the type of a piece (e.g. when a pawn is promoted) and keeps the
+ * game's bitboards, attack maps and key up to date.
+ *
+ * @param board The game currently being played
+ * @param p     The piece changing type
+ * @param type  The piece's new type
+ */
+void retype(Game *board, Piece *p, uint_fast8_t type)
 {
-	Piece *CheckedKing = team[I_KING];
-
-	bool ret = false;
-	if(!is_valid_move(board, CheckedKing, CheckedKing->currentLocation, VALID_SELFCHECK))
+	if(p->currentLocation != 0)
 	{
-		Piece **enemies = CheckedKing->color == TEAM_WHITE ? board->Black : board->White;
-		Piece *current;
-		uint_fast8_t i, x, y;
-		ret = true;
+		const uint_fast8_t index = location_getindex(p->currentLocation);
+		const Bitboard bit = BB_SQUARE(index);
 
-		for(i = I_PAWN1; ret && i <= I_ROOK2; i++)
-		{
-			current = team[i];
+		board->typeBoards[TYPE_INDEX(p->type)] &= ~bit;
+		board->typeBoards[TYPE_INDEX(type)] |= bit;
 
-			for(x = 1; ret && current->currentLocation != 0 && x < 9; x++)
-			{
-				for(y = 1; ret && y < 9; y++)
-				{
-					Location check;
-					location_assign(&check, x, y);
+		board->hash ^= ZOBRIST_PIECES[p->color - 1][TYPE_INDEX(p->type)][index];
+		board->hash ^= ZOBRIST_PIECES[p->color - 1][TYPE_INDEX(type)][index];
+	}
+
+	p->type = type;
 
-					if(is_valid_move(board, current, check, 0))
-					{
-						bool enemyOn;
-						int_fast8_t enemyIndex;
-						Piece *enemy;
-						Location old;
+	if(p->currentLocation != 0) update_attacks(board, p, BB_EMPTY);
+}
 
-						enemyOn = piece_is_on(board, check) == enemies[0]->color;
+/**
+ * Captures piece i.e. takes the piece off of the board by setting its location to 0.
+ *
+ * @param board The game currently being played
+ * @param p The piece being captured
+ */
+void capture(Game *board, Piece *p)
+{
+	relocate(board, p, 0);
+}
+
+/**
+ * Returns a pointer to the piece that resides at the given location.
+ *
+ * @param board      The game instance being played
+ * @param loc        The location where a piece should be
+ *
+ * @returns the piece at loc, or NULL if loc is empty or off of the board
+ */
+Piece *piece_at(Game *board, Location loc)
+{
+	Piece *ret = NULL;
 
-						if(enemyOn)
-						{
-							int_fast8_t j;
-							bool match = false;
-							for(j = I_PAWN1; !match && j <= I_ROOK2; j++)
-								if(enemies[j]->currentLocation != 0 && enemies[j]->currentLocation == check)
-									match = true;
-							assert(match);
+	if(IS_ON_BOARD(location_getfile(loc), location_getrank(loc)))
+		ret = piece_on(board, location_getindex(loc));
 
-							enemyIndex = --j;
-							enemy = enemies[j];
+	return ret;
+}
 
-							capture(board, enemy);
-						}
+/**
+ * Returns a pointer to the piece on a square.
+ *
+ * @param board   The game instance being played
+ * @param index   The square's location_getindex()
+ *
+ * @returns the piece on the square, or NULL if it's empty
+ */
+Piece *piece_on(Game *board, uint_fast8_t index)
+{
+	const uint_fast8_t i = board->mailbox[index];
 
-						old = current->currentLocation;
+	return i == NO_PIECE ? NULL : GAME_PIECE(board, i);
+}
 
-						current->currentLocation = check;
+/**
+ * Deduces if there is a piece residing on the given location.
+ *
+ * @param board The game instance being played
+ * @param loc The location being tested
+ *
+ * @return 0 if there is no piece on the board, TEAM_WHITE if
+ *           there is a white piece on the board, or TEAM_BLACK
+ *           if there is a black piece on the board
+ */
+int_fast8_t piece_is_on(Game *board, const Location loc)
+{
+	int_fast8_t ret = 0;
 
-						if(is_valid_move(board, CheckedKing, CheckedKing->currentLocation, VALID_SELFCHECK))
-							ret = false;
+	uint_fast8_t h = location_getfile(loc);
+	uint_fast8_t v = location_getrank(loc);
 
-						current->currentLocation = old;
+	if(IS_ON_BOARD(h, v))
+	{
+		const Bitboard bit = BB_LOCATION(loc);
 
-						if(enemyOn) uncapture(board, enemy, enemyIndex, check);
-					}
-				}
-			}
-		}
+		if(board->occupied[TEAM_WHITE] & bit)
+			ret = TEAM_WHITE;
+		else if(board->occupied[TEAM_BLACK] & bit)
+			ret = TEAM_BLACK;
 	}
 
 	return ret;
 }
 
-int_fast8_t check_if_check(Game *board)
+/**
+ * Works out if the side to move is in check, checkmated or stalemated. If the game has a
+ * status cache the answer is looked up there first and stored there afterwards.
+ *
+ * @param board  The game instance being played
+ *
+ * @return CHECK_NO, CHECK_YES, CHECK_YES | CHECK_MATE or CHECK_STALEMATE
+ */
+uint_fast8_t position_status(Game *board)
 {
-	uint_fast8_t ret;    
+	const Piece *king = &((board->toMove == TEAM_WHITE ? board->White : board->Black)[I_KING]);
+	uint_fast8_t ret;
 
-	const Piece *WhiteKing = board->White[I_KING];
-	const Piece *BlackKing = board->Black[I_KING];
+	if(board->statusCache != NULL && status_cache_probe(board->statusCache, board->hash, &ret))
+		return ret;
 
-	const bool WKingValid = is_valid_move(board, WhiteKing, WhiteKing->currentLocation, VALID_SELFCHECK);
-	const bool BKingValid = is_valid_move(board, BlackKing, BlackKing->currentLocation, VALID_SELFCHECK);
+	ret = square_is_attacked(board, location_getindex(king->currentLocation), board->toMove == TEAM_WHITE ? TEAM_BLACK : TEAM_WHITE) ? CHECK_YES : CHECK_NO;
 
-	const bool BOTH_KINGS_ARE_IN_CHECK = WKingValid || BKingValid;
-	assert(BOTH_KINGS_ARE_IN_CHECK);
-
-
-	if(WKingValid ^ BKingValid)
-	{
-		bool mate;
-		ret = CHECK_YES;
-
-		mate = check_if_mate(board, !WKingValid ? board->White : board->Black);
-
-		ret = mate ? ret | CHECK_MATE : ret;
-	}
-	else
-		ret = CHECK_NO;
+	if(!has_any_legal_move(board, board->toMove))
+		ret |= ret == CHECK_YES ? CHECK_MATE : CHECK_STALEMATE;
 
+	if(board->statusCache != NULL)
+		status_cache_store(board->statusCache, board->hash, ret);
 
 	return ret;
 }
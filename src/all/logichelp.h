@@ -3,10 +3,12 @@
 
 #include "mischelp.h"
 
+void relocate(Game*, Piece*, Location);
+void retype(Game*, Piece*, uint_fast8_t);
 void capture(Game*, Piece*);
-void uncapture(Game*, Piece*, uint_fast8_t, Location);
+Piece *piece_at(Game*, Location);
+Piece *piece_on(Game*, uint_fast8_t);
 int_fast8_t piece_is_on(Game*, const Location);
-int_fast8_t check_if_check(Game*);
-bool path_is_blocked(Game*, const Location, const Location, const int_fast8_t, const int_fast8_t);
+uint_fast8_t position_status(Game*);
 
 #endif /* LOGICHELP_H_INCLUDED */
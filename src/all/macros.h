@@ -75,11 +75,30 @@
 #define         PIECE_KING              8
 #define         PIECE_QUEEN             3
 
+#define         PIECE_TYPES             6
+#define         TYPE_INDEX(t)           ((t) == PIECE_KING ? 5 : (t))   /* Packs the piece type macros into 0-5 for indexing arrays */
+
+/*
+ * Pieces are named in a game's mailbox and undo records by an index: 0-15 are White[] and 16-31 are Black[],
+ * so a game holds no pointers into itself.
+ */
+#define         NO_PIECE                0xff
+#define         GAME_PIECE(g, i)        ((i) < PIECES_PER_SIDE ? &((g)->White[i]) : &((g)->Black[(i) - PIECES_PER_SIDE]))
+#define         PIECE_INDEX(g, p)       ((p)->color == TEAM_WHITE ? (p) - (g)->White : PIECES_PER_SIDE + ((p) - (g)->Black))
+
+#define         CASTLE_WHITE_KINGSIDE   0x1
+#define         CASTLE_WHITE_QUEENSIDE  0x2
+#define         CASTLE_BLACK_KINGSIDE   0x4
+#define         CASTLE_BLACK_QUEENSIDE  0x8
+
 #define         IS_ON_BOARD(h, v)       v > 0 && v < 9 && h > 0 && h < 9
 
 #define         CHECK_NO                0x0
 #define         CHECK_YES               0x80
 #define         CHECK_MATE              0x40
+#define         CHECK_STALEMATE         0x20
+
+#define         STATUS_CACHE_ENTRIES    4096  /* Rounded down to a power of two when the cache is made */
 
 #define         DECIPHER_BROADCAST      0x1
 
@@ -120,11 +139,69 @@
 
 #define         PP_SHOWCAPTURED 0x1
 
-#define         VALID_IGNORECOLOR       0x4   /* Doesn't take the color of the pieces into account, thus treating every space as vacant. Used for recursion */
-#define         VALID_PAWNATKONLY       0x8   /* Will only take the pawn's diagonal attack into account, not the forward move */
-#define         VALID_KINGNOLIMIT       0x10  /* Will ignore the king's limit on traveling distance. Used to check castling */
-#define         VALID_BROADCASTCALL     0x1   /* Does printf's throughout the method */
-#define         VALID_SELFCHECK         0x40
+/*
+ * A PackedMove holds a move in 16 bits: bits [5:0] are the square the piece leaves,
+ * bits [11:6] the square it lands on and bits [15:12] say what kind of move it is.
+ */
+#define         PM_FROM(m)              ((m) & 0x3f)
+#define         PM_TO(m)                (((m) >> 6) & 0x3f)
+#define         PM_FLAGS(m)             (((m) >> 12) & 0xf)
+#define         PM_PACK(from, to, fl)   ((PackedMove)((from) | ((to) << 6) | ((fl) << 12)))
+
+#define         PM_QUIET                0x0   /* 0000 */
+#define         PM_DOUBLEPUSH           0x1   /* 0001 */
+#define         PM_CASTLE_KINGSIDE      0x2   /* 0010 */
+#define         PM_CASTLE_QUEENSIDE     0x3   /* 0011 */
+#define         PM_CAPTURE              0x4   /* 0100 */
+#define         PM_ENPASSANT            0x5   /* 0101 */
+#define         PM_PROMOTION            0x8   /* 1000      The lowest 2 bits then say what the pawn becomes */
+#define         PM_PROMOTIONMASK        0x3   /* 0011 */
+#define         PM_PROMOTION_KNIGHT     0x8   /* 1000 */
+#define         PM_PROMOTION_BISHOP     0x9   /* 1001 */
+#define         PM_PROMOTION_ROOK       0xa   /* 1010 */
+#define         PM_PROMOTION_QUEEN      0xb   /* 1011 */
+
+#define         PM_NONE                 0x0   /* From a1 to a1, which no move is */
+
+/*
+ * A move in standard algebraic notation taken apart by san_parse(), before it's matched
+ * against the position's legal moves.
+ */
+#define         SAN_ANY                 8     /* The SAN doesn't say which file or rank the piece comes from */
+
+#define         SAN_CAPTURE             0x01
+#define         SAN_CHECK               0x02
+#define         SAN_MATE                0x04
+#define         SAN_CASTLE_KINGSIDE     0x08
+#define         SAN_CASTLE_QUEENSIDE    0x10
+#define         SAN_CASTLE              0x18
+
+#define         SAN_BENCHMARK_ROUNDS    200000 /* How many times san_benchmark() goes through its game */
+
+/*
+ * Every ply in a game's history keeps a PackedMove and a byte of notes: the TYPE_INDEX() of the
+ * piece that moved in the low 3 bits, and what else its SAN shows that the move itself can't.
+ */
+#define         PLY_TYPEMASK            0x07  /* 0000 0111 */
+#define         PLY_FILESPECIFIED       0x08  /* 0000 1000      The piece's file tells it apart from the others of its type */
+#define         PLY_RANKSPECIFIED       0x10  /* 0001 0000      The piece's rank tells it apart from the others of its type */
+#define         PLY_CHECK               0x20  /* 0010 0000 */
+#define         PLY_MATE                0x40  /* 0100 0000 */
+
+#define         PLY_SAN_LENGTH          10    /* The SAN of a ply is at most 8 characters. The longest are 7, e.g. exd8=Q# or Qa1xb2+ */
+#define         PLY_INPUT_LENGTH        32    /* Room for a move as it's read in, which can be longer with annotations, e.g. b7xa8=Q+!? */
+#define         RESULT_LENGTH           8     /* 1/2-1/2 */
+
+#define         GAME_ARENA_PLIES        256   /* The moves a game's history holds in the game's own block before it moves to the heap */
+
+#define         PGN_BUFFER_SIZE         65536 /* How much of a PGN file is read at a time */
+#define         PGN_BENCHMARK_BYTES     134217728 /* 128 MB, the size of the file pgn_benchmark() makes up when it isn't given one */
+#define         PGN_TAGS_LENGTH         1024  /* Room for a game's tag pairs in its index, the ones that don't fit aren't kept */
+
+#define         BATCH_CHUNK             32    /* How many games a worker takes off the queue at a time */
+#define         BATCH_MAX_THREADS       256
+
+#define         MOVEBUFFER_SIZE         256   /* No legal position has more than 218 moves */
 
 
 #define 		ICURSE_SHOWMOVES		0x2
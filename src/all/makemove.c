@@ -0,0 +1,187 @@
+#include "makemove.h"
+#include "logichelp.h"
+#include "zobrist.h"
+
+/*
+ * make_move() plays a move on the board and fills in an Undo record, and unmake_move()
+ * puts the board back from that record. Every part of the program that tries moves out,
+ * takes them back or walks the game tree goes through these two, so there's exactly one
+ * place that knows how a move changes the position.
+ */
+
+/*
+ * The castling rights that are kept when a piece moves from or to each square. Moving the king
+ * loses both of its side's rights, and moving a rook or capturing it on its corner loses one.
+ */
+static const uint_least8_t CASTLING_KEPT[64] =
+{
+	13, 15, 15, 15, 12, 15, 15, 14,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	 7, 15, 15, 15,  3, 15, 15, 11
+};
+
+static void castle_rook_squares(PackedMove move, uint_fast8_t *from, uint_fast8_t *to)
+{
+	const uint_fast8_t base = PM_FROM(move) - 4;
+
+	*from = PM_FLAGS(move) == PM_CASTLE_KINGSIDE ? base + 7 : base;
+	*to = PM_FLAGS(move) == PM_CASTLE_KINGSIDE ? base + 5 : base + 3;
+}
+
+static uint_fast8_t en_passant_victim(PackedMove move, int_fast8_t color)
+{
+	return color == TEAM_WHITE ? PM_TO(move) - 8 : PM_TO(move) + 8;
+}
+
+/**
+ * Plays a move on the board. The move has to be pseudo-legal; a move that leaves the
+ * mover's king in check is played all the same and can be taken back with unmake_move().
+ *
+ * @param board  The game instance being played
+ * @param move   The move being played
+ * @param undo   Filled in with what unmake_move() needs to take the move back
+ */
+void make_move(Game *board, PackedMove move, Undo *undo)
+{
+	const uint_fast8_t from = PM_FROM(move);
+	const uint_fast8_t to = PM_TO(move);
+	const uint_fast8_t flags = PM_FLAGS(move);
+	Piece *mover = piece_on(board, from);
+
+	assert(mover != NULL);
+
+	undo->move = move;
+	undo->hash = board->hash;
+	undo->captured = NO_PIECE;
+	undo->enPassant = board->enPassant;
+	undo->castling = board->castling;
+
+	/* relocate() and retype() take care of the piece keys, the rest of the key is done here */
+	if(board->enPassant != 0)
+		board->hash ^= ZOBRIST_EN_PASSANT[location_getfile(board->enPassant) - 1];
+
+	if(flags == PM_ENPASSANT)
+		undo->captured = board->mailbox[en_passant_victim(move, mover->color)];
+	else if(flags & PM_CAPTURE)
+		undo->captured = board->mailbox[to];
+
+	if(undo->captured != NO_PIECE) capture(board, GAME_PIECE(board, undo->captured));
+
+	relocate(board, mover, location_from_index(to));
+
+	if(flags == PM_CASTLE_KINGSIDE || flags == PM_CASTLE_QUEENSIDE)
+	{
+		uint_fast8_t rookFrom, rookTo;
+		Piece *rook;
+
+		castle_rook_squares(move, &rookFrom, &rookTo);
+		rook = piece_on(board, rookFrom);
+		assert(rook != NULL && rook->type == PIECE_ROOK);
+
+		relocate(board, rook, location_from_index(rookTo));
+	}
+
+	if(flags & PM_PROMOTION)
+	{
+		const uint_fast8_t types[4] = {PIECE_KNIGHT, PIECE_BISHOP, PIECE_ROOK, PIECE_QUEEN};
+		retype(board, mover, types[flags & PM_PROMOTIONMASK]);
+	}
+
+	board->enPassant = flags == PM_DOUBLEPUSH ? location_from_index((from + to) / 2) : 0;
+	board->toMove = mover->color == TEAM_WHITE ? TEAM_BLACK : TEAM_WHITE;
+
+	board->castling &= CASTLING_KEPT[from] & CASTLING_KEPT[to];
+	board->hash ^= ZOBRIST_CASTLING[undo->castling] ^ ZOBRIST_CASTLING[board->castling];
+
+	if(board->enPassant != 0)
+		board->hash ^= ZOBRIST_EN_PASSANT[location_getfile(board->enPassant) - 1];
+	board->hash ^= ZOBRIST_BLACK_TO_MOVE;
+}
+
+/**
+ * Takes back a move played with make_move(). Moves have to be taken back in the
+ * reverse of the order they were played in.
+ *
+ * @param board  The game instance being played
+ * @param undo   The record make_move() filled in
+ */
+void unmake_move(Game *board, const Undo *undo)
+{
+	const uint_fast8_t from = PM_FROM(undo->move);
+	const uint_fast8_t to = PM_TO(undo->move);
+	const uint_fast8_t flags = PM_FLAGS(undo->move);
+	Piece *mover = piece_on(board, to);
+
+	assert(mover != NULL);
+
+	if(flags & PM_PROMOTION) retype(board, mover, PIECE_PAWN);
+
+	if(flags == PM_CASTLE_KINGSIDE || flags == PM_CASTLE_QUEENSIDE)
+	{
+		uint_fast8_t rookFrom, rookTo;
+		Piece *rook;
+
+		castle_rook_squares(undo->move, &rookFrom, &rookTo);
+		rook = piece_on(board, rookTo);
+
+		relocate(board, rook, location_from_index(rookFrom));
+	}
+
+	relocate(board, mover, location_from_index(from));
+
+	if(undo->captured != NO_PIECE)
+		relocate(board, GAME_PIECE(board, undo->captured), location_from_index(flags == PM_ENPASSANT ? en_passant_victim(undo->move, mover->color) : to));
+
+	board->enPassant = undo->enPassant;
+	board->castling = undo->castling;
+	board->toMove = mover->color;
+	board->hash = undo->hash;
+}
+
+/**
+ * Plays a move and keeps its undo record on the game's undo stack so that
+ * it can be taken back later with pop_move().
+ *
+ * @param board  The game instance being played
+ * @param move   The move being played
+ */
+void push_move(Game *board, PackedMove move)
+{
+	if(board->undoCount == board->undoCapacity)
+	{
+		Undo *grown;
+
+		board->undoCapacity = board->undoCapacity == 0 ? 64 : 2 * board->undoCapacity;
+		grown = realloc(board->ownsUndoStack ? board->undoStack : NULL, board->undoCapacity * sizeof(Undo));
+		assert(grown != NULL);
+
+		if(!board->ownsUndoStack) memcpy(grown, board->undoStack, board->undoCount * sizeof(Undo));
+		board->undoStack = grown;
+		board->ownsUndoStack = true;
+	}
+
+	make_move(board, move, &(board->undoStack[board->undoCount]));
+	board->undoCount++;
+}
+
+/**
+ * Takes back the latest move played with push_move().
+ *
+ * @param board  The game instance being played
+ *
+ * @return false if there was no move to take back
+ */
+bool pop_move(Game *board)
+{
+	if(board->undoCount == 0) return false;
+
+	board->undoCount--;
+	unmake_move(board, &(board->undoStack[board->undoCount]));
+
+	return true;
+}
@@ -0,0 +1,11 @@
+#ifndef MAKEMOVE_H_INCLUDED
+#define MAKEMOVE_H_INCLUDED
+
+#include "chess.h"
+
+void make_move(Game*, PackedMove, Undo*);
+void unmake_move(Game*, const Undo*);
+void push_move(Game*, PackedMove);
+bool pop_move(Game*);
+
+#endif /* MAKEMOVE_H_INCLUDED */
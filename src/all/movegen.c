@@ -0,0 +1,477 @@
+#include "movegen.h"
+#include "attacks.h"
+
+#define OTHER_TEAM(color) ((color) == TEAM_WHITE ? TEAM_BLACK : TEAM_WHITE)
+
+/* What a pawn becomes by the lowest 2 bits of a promotion's PM_ flags */
+static const uint_fast8_t PROMOTIONS[4] = { PIECE_KNIGHT, PIECE_BISHOP, PIECE_ROOK, PIECE_QUEEN };
+
+/**
+ * Finds every piece of one color that attacks a square.
+ *
+ * @param board      The game instance being played
+ * @param index      The square being attacked
+ * @param color      The color of the attacking pieces
+ * @param occupancy  The occupied squares to use. Pieces whose square isn't in here
+ *                   are treated as captured
+ *
+ * @return the squares of the pieces attacking index
+ */
+Bitboard attackers_to(Game *board, uint_fast8_t index, int_fast8_t color, Bitboard occupancy)
+{
+	const Bitboard *types = board->typeBoards;
+	const Bitboard queens = types[TYPE_INDEX(PIECE_QUEEN)];
+	Bitboard ret;
+
+	ret = PAWN_ATTACKS[OTHER_TEAM(color) - 1][index] & types[TYPE_INDEX(PIECE_PAWN)];
+	ret |= KNIGHT_ATTACKS[index] & types[TYPE_INDEX(PIECE_KNIGHT)];
+	ret |= KING_ATTACKS[index] & types[TYPE_INDEX(PIECE_KING)];
+	ret |= bishop_attacks(index, occupancy) & (types[TYPE_INDEX(PIECE_BISHOP)] | queens);
+	ret |= rook_attacks(index, occupancy) & (types[TYPE_INDEX(PIECE_ROOK)] | queens);
+
+	return ret & board->occupied[color] & occupancy;
+}
+
+/**
+ * Determines if any piece of the given color attacks a square, using the game's attack maps.
+ * Those stop at the first piece in each direction, so the square behind a king that's in
+ * check along a line doesn't count as attacked. attackers_to() without the king covers that.
+ *
+ * @param board  The game instance being played
+ * @param index  The square being tested
+ * @param color  The color of the attacking side
+ *
+ * @return true if the square is attacked
+ */
+bool square_is_attacked(Game *board, uint_fast8_t index, int_fast8_t color)
+{
+	return (board->attacked[color] & BB_SQUARE(index)) != BB_EMPTY;
+}
+
+/**
+ * Determines if a move leaves the mover's king out of check without actually making it.
+ * The occupancy after the move is worked out and the king's square is tested against it.
+ *
+ * @param board  The game instance being played
+ * @param color  The color making the move
+ * @param move   The move being tested
+ *
+ * @return true if the move doesn't leave the king in check
+ */
+static bool king_is_safe_after(Game *board, int_fast8_t color, PackedMove move)
+{
+	const uint_fast8_t from = PM_FROM(move);
+	const uint_fast8_t to = PM_TO(move);
+	const Piece *king = &((color == TEAM_WHITE ? board->White : board->Black)[I_KING]);
+
+	Bitboard occupancy, captured;
+	uint_fast8_t kingIndex;
+
+	captured = BB_SQUARE(to);
+	if(PM_FLAGS(move) == PM_ENPASSANT)
+		captured |= BB_SQUARE(color == TEAM_WHITE ? to - 8 : to + 8);
+
+	occupancy = (board->occupied[0] & ~BB_SQUARE(from) & ~captured) | BB_SQUARE(to);
+	kingIndex = from == location_getindex(king->currentLocation) ? to : location_getindex(king->currentLocation);
+
+	/* A captured piece is still in the bitboards, so it has to be masked out by hand */
+	return (attackers_to(board, kingIndex, OTHER_TEAM(color), occupancy) & ~captured) == BB_EMPTY;
+}
+
+/* The squares strictly between two squares on the same line, or nothing if they aren't on one */
+static Bitboard between(uint_fast8_t a, uint_fast8_t b)
+{
+	if(rook_attacks(a, BB_EMPTY) & BB_SQUARE(b))
+		return rook_attacks(a, BB_SQUARE(b)) & rook_attacks(b, BB_SQUARE(a));
+	if(bishop_attacks(a, BB_EMPTY) & BB_SQUARE(b))
+		return bishop_attacks(a, BB_SQUARE(b)) & bishop_attacks(b, BB_SQUARE(a));
+
+	return BB_EMPTY;
+}
+
+/**
+ * Works out what's checking a king and what's pinned to it. With that, whether a move
+ * is legal can be decided straight from its squares (see move_is_legal()).
+ *
+ * @param board  The game instance being played
+ * @param color  The color of the king
+ * @param info   Where the results are written to
+ */
+void check_info(Game *board, int_fast8_t color, CheckInfo *info)
+{
+	const Bitboard *types = board->typeBoards;
+	const Bitboard queens = types[TYPE_INDEX(PIECE_QUEEN)];
+	const Bitboard enemy = board->occupied[OTHER_TEAM(color)];
+	const Piece *king = &((color == TEAM_WHITE ? board->White : board->Black)[I_KING]);
+	Bitboard snipers;
+	uint_fast8_t k;
+
+	info->color = color;
+	info->checkers = BB_EMPTY;
+	info->pinned = BB_EMPTY;
+	info->evasions = ~BB_EMPTY;
+
+	/* Only reachable by capturing the king with a command */
+	if(king->currentLocation == 0)
+	{
+		info->king = 64;
+		return;
+	}
+
+	k = info->king = location_getindex(king->currentLocation);
+
+	/* Pawns and knights can check but not pin */
+	info->checkers = ((PAWN_ATTACKS[color - 1][k] & types[TYPE_INDEX(PIECE_PAWN)]) | (KNIGHT_ATTACKS[k] & types[TYPE_INDEX(PIECE_KNIGHT)])) & enemy;
+
+	/* Every enemy slider lined up with the king either checks it, pins the only piece in between, or is blocked */
+	snipers = (rook_attacks(k, BB_EMPTY) & (types[TYPE_INDEX(PIECE_ROOK)] | queens)) | (bishop_attacks(k, BB_EMPTY) & (types[TYPE_INDEX(PIECE_BISHOP)] | queens));
+	for(snipers &= enemy; snipers != BB_EMPTY; snipers &= snipers - 1)
+	{
+		const uint_fast8_t sniper = bitboard_first(snipers);
+		const Bitboard line = between(k, sniper);
+		const Bitboard blockers = line & board->occupied[0];
+
+		if(blockers == BB_EMPTY)
+			info->checkers |= BB_SQUARE(sniper);
+		else if((blockers & (blockers - 1)) == BB_EMPTY && (blockers & board->occupied[color]))
+		{
+			info->pinned |= blockers;
+			info->pinRays[bitboard_first(blockers)] = line | BB_SQUARE(sniper);
+		}
+	}
+
+	/* In check, a move has to take the checker or get in its way. In double check only the king can move */
+	if(info->checkers != BB_EMPTY)
+		info->evasions = info->checkers & (info->checkers - 1) ? BB_EMPTY : info->checkers | between(k, bitboard_first(info->checkers));
+}
+
+/**
+ * Determines if a pseudo-legal move is legal, i.e. it doesn't leave the mover's king in check.
+ *
+ * @param board  The game instance being played
+ * @param info   What check_info() found for the side making the move
+ * @param move   The move being tested
+ *
+ * @return true if the move is legal
+ */
+bool move_is_legal(Game *board, const CheckInfo *info, PackedMove move)
+{
+	const uint_fast8_t from = PM_FROM(move);
+	const uint_fast8_t to = PM_TO(move);
+	const int_fast8_t enemy = OTHER_TEAM(info->color);
+
+	if(PM_FLAGS(move) == PM_CASTLE_KINGSIDE || PM_FLAGS(move) == PM_CASTLE_QUEENSIDE)
+		return can_castle(board, info->color, PM_FLAGS(move) == PM_CASTLE_KINGSIDE);
+
+	/* The attack maps stop at the king, so a king in check also needs the line behind it tested */
+	if(from == info->king)
+		return !square_is_attacked(board, to, enemy) &&
+		       (info->checkers == BB_EMPTY || attackers_to(board, to, enemy, board->occupied[0] & ~BB_SQUARE(from)) == BB_EMPTY);
+
+	/* Taking en passant empties two squares, which can uncover the king along the rank */
+	if(PM_FLAGS(move) == PM_ENPASSANT)
+		return king_is_safe_after(board, info->color, move);
+
+	return (info->evasions & BB_SQUARE(to)) && (!(info->pinned & BB_SQUARE(from)) || (info->pinRays[from] & BB_SQUARE(to)));
+}
+
+/**
+ * Determines if a move checks the other side's king without actually making it. The
+ * occupancy after the move is worked out, then the king is tested against the piece where
+ * it lands and against every slider the move uncovers.
+ *
+ * @param board  The game instance being played
+ * @param color  The color making the move
+ * @param move   The move being tested. It has to be legal
+ *
+ * @return true if the move gives check
+ */
+bool gives_check(Game *board, int_fast8_t color, PackedMove move)
+{
+	const uint_fast8_t from = PM_FROM(move);
+	const uint_fast8_t to = PM_TO(move);
+	const uint_fast8_t flags = PM_FLAGS(move);
+	const Bitboard *types = board->typeBoards;
+	const Bitboard queens = types[TYPE_INDEX(PIECE_QUEEN)];
+	const Piece *king = &((color == TEAM_WHITE ? board->Black : board->White)[I_KING]);
+
+	Bitboard occupancy, reach, sliders;
+	uint_fast8_t k, type;
+
+	/* Only reachable by capturing the king with a command */
+	if(king->currentLocation == 0) return false;
+
+	k = location_getindex(king->currentLocation);
+	occupancy = (board->occupied[0] & ~BB_SQUARE(from)) | BB_SQUARE(to);
+
+	if(flags == PM_CASTLE_KINGSIDE || flags == PM_CASTLE_QUEENSIDE)
+	{
+		/* Only the rook can give check, from the square it ends up on next to the king */
+		const uint_fast8_t rook = flags == PM_CASTLE_KINGSIDE ? from + 1 : from - 1;
+
+		occupancy = (occupancy & ~BB_SQUARE(flags == PM_CASTLE_KINGSIDE ? from + 3 : from - 4)) | BB_SQUARE(rook);
+
+		return (rook_attacks(rook, occupancy) & BB_SQUARE(k)) != BB_EMPTY;
+	}
+
+	if(flags == PM_ENPASSANT)
+		occupancy &= ~BB_SQUARE(color == TEAM_WHITE ? to - 8 : to + 8);
+
+	/* What the piece is once it lands */
+	if(flags & PM_PROMOTION)
+		type = TYPE_INDEX(PROMOTIONS[flags & PM_PROMOTIONMASK]);
+	else
+		for(type = 0; !(types[type] & BB_SQUARE(from)); type++);
+
+	switch(type)
+	{
+		case TYPE_INDEX(PIECE_PAWN):
+			reach = PAWN_ATTACKS[color - 1][to];
+			break;
+		case TYPE_INDEX(PIECE_KNIGHT):
+			reach = KNIGHT_ATTACKS[to];
+			break;
+		case TYPE_INDEX(PIECE_BISHOP):
+			reach = bishop_attacks(to, occupancy);
+			break;
+		case TYPE_INDEX(PIECE_ROOK):
+			reach = rook_attacks(to, occupancy);
+			break;
+		case TYPE_INDEX(PIECE_QUEEN):
+			reach = queen_attacks(to, occupancy);
+			break;
+		default:
+			reach = BB_EMPTY;	/* a king can't give check itself */
+	}
+
+	if(reach & BB_SQUARE(k)) return true;
+
+	/* Anything lined up behind the square the piece left */
+	sliders = (bishop_attacks(k, occupancy) & (types[TYPE_INDEX(PIECE_BISHOP)] | queens)) | (rook_attacks(k, occupancy) & (types[TYPE_INDEX(PIECE_ROOK)] | queens));
+
+	return (sliders & board->occupied[color] & ~BB_SQUARE(from)) != BB_EMPTY;
+}
+
+/**
+ * Adds a move that's known to be legal to the buffer.
+ *
+ * @return the number of moves added
+ */
+static uint_fast16_t add(MoveBuffer *buffer, PackedMove move)
+{
+	if(buffer != NULL)
+	{
+		assert(buffer->count < MOVEBUFFER_SIZE);
+		buffer->moves[buffer->count++] = move;
+	}
+
+	return 1;
+}
+
+/**
+ * Adds a legal move with each of the four promotions.
+ */
+static uint_fast16_t add_promotions(MoveBuffer *buffer, uint_fast8_t from, uint_fast8_t to, uint_fast8_t flags)
+{
+	uint_fast8_t promotion;
+
+	for(promotion = PM_PROMOTION_KNIGHT; promotion <= PM_PROMOTION_QUEEN; promotion++)
+		add(buffer, PM_PACK(from, to, promotion | flags));
+
+	return 4;
+}
+
+/**
+ * Determines if a side can castle right now. It needs the castling right, the squares between
+ * the king and rook have to be empty, and the king can't be in, pass through, or land on an
+ * attacked square.
+ *
+ * @param board     The game instance being played
+ * @param color     The color castling
+ * @param kingside  true for O-O, false for O-O-O
+ *
+ * @return true if the castle is legal
+ */
+bool can_castle(Game *board, int_fast8_t color, bool kingside)
+{
+	const uint_fast8_t base = color == TEAM_WHITE ? 0 : 56;
+	const uint_fast8_t right = (kingside ? CASTLE_WHITE_KINGSIDE : CASTLE_WHITE_QUEENSIDE) << (color == TEAM_WHITE ? 0 : 2);
+	const Bitboard empty = (kingside ? (Bitboard)0x60 : (Bitboard)0x0e) << base;	/* f1 g1 : b1 c1 d1 */
+	const Bitboard safe = (kingside ? (Bitboard)0x70 : (Bitboard)0x1c) << base;		/* e1 f1 g1 : c1 d1 e1 */
+
+	return (board->castling & right) && !(board->occupied[0] & empty) && !(board->attacked[OTHER_TEAM(color)] & safe);
+}
+
+/**
+ * Adds every castling move that's legal.
+ */
+static uint_fast16_t add_castles(Game *board, int_fast8_t color, MoveBuffer *buffer, bool firstOnly)
+{
+	const uint_fast8_t base = color == TEAM_WHITE ? 0 : 56;
+	uint_fast16_t ret = 0;
+
+	if(can_castle(board, color, true))
+		ret += add(buffer, PM_PACK(base + 4, base + 6, PM_CASTLE_KINGSIDE));
+
+	if(!(firstOnly && ret) && can_castle(board, color, false))
+		ret += add(buffer, PM_PACK(base + 4, base + 2, PM_CASTLE_QUEENSIDE));
+
+	return ret;
+}
+
+/**
+ * Walks every piece of one color and finds all of its legal moves.
+ *
+ * @param board     The game instance being played
+ * @param color     The color whose moves are generated
+ * @param buffer    Where the moves are written to. Can be NULL if only the count matters
+ * @param firstOnly Stop as soon as one legal move is found
+ *
+ * @return the number of legal moves found
+ */
+static uint_fast16_t generate(Game *board, int_fast8_t color, MoveBuffer *buffer, bool firstOnly)
+{
+	const Bitboard own = board->occupied[color];
+	const Bitboard enemy = board->occupied[OTHER_TEAM(color)];
+	const Bitboard occupancy = board->occupied[0];
+	const int_fast8_t forward = color == TEAM_WHITE ? 8 : -8;
+
+	Piece *team = color == TEAM_WHITE ? board->White : board->Black;
+	CheckInfo info;
+	uint_fast16_t ret = 0;
+	uint_fast8_t i;
+
+	if(buffer != NULL) buffer->count = 0;
+
+	check_info(board, color, &info);
+
+	for(i = 0; !(firstOnly && ret) && i < PIECES_PER_SIDE; i++)
+	{
+		const Piece *p = &(team[i]);
+		uint_fast8_t from;
+		Bitboard targets, allowed;
+
+		if(p->currentLocation == 0) continue;
+
+		from = location_getindex(p->currentLocation);
+
+		if(p->type == PIECE_KING)
+		{
+			/* Squares that are already attacked can be skipped, the rest only need testing when in check */
+			targets = KING_ATTACKS[from] & ~own & ~(board->attacked[OTHER_TEAM(color)]);
+			while(!(firstOnly && ret) && targets != BB_EMPTY)
+			{
+				const uint_fast8_t to = bitboard_first(targets);
+				const PackedMove move = PM_PACK(from, to, enemy & BB_SQUARE(to) ? PM_CAPTURE : PM_QUIET);
+				targets &= targets - 1;
+
+				if(info.checkers == BB_EMPTY || move_is_legal(board, &info, move))
+					ret += add(buffer, move);
+			}
+
+			if(!(firstOnly && ret) && info.checkers == BB_EMPTY)
+				ret += add_castles(board, color, buffer, firstOnly);
+
+			continue;
+		}
+
+		/* Every other piece has to deal with a check and can't leave the line it's pinned along */
+		allowed = info.evasions;
+		if(info.pinned & BB_SQUARE(from)) allowed &= info.pinRays[from];
+
+		switch(p->type)
+		{
+			case PIECE_PAWN:
+			{
+				uint_fast8_t one;
+				bool promotes;
+
+				/* Only reachable by placing a pawn there with a command */
+				if(from / 8 == (color == TEAM_WHITE ? 7 : 0)) continue;
+
+				one = from + forward;
+				promotes = one / 8 == 0 || one / 8 == 7;
+
+				if(!(occupancy & BB_SQUARE(one)))
+				{
+					if(allowed & BB_SQUARE(one))
+						ret += promotes ? add_promotions(buffer, from, one, 0) : add(buffer, PM_PACK(from, one, PM_QUIET));
+
+					/* Still on its starting rank */
+					if(from / 8 == (color == TEAM_WHITE ? 1 : 6) && !(occupancy & BB_SQUARE(one + forward)) && (allowed & BB_SQUARE(one + forward)))
+						ret += add(buffer, PM_PACK(from, one + forward, PM_DOUBLEPUSH));
+				}
+
+				targets = PAWN_ATTACKS[color - 1][from] & enemy & allowed;
+				while(targets != BB_EMPTY)
+				{
+					const uint_fast8_t to = bitboard_first(targets);
+					targets &= targets - 1;
+
+					ret += promotes ? add_promotions(buffer, from, to, PM_CAPTURE) : add(buffer, PM_PACK(from, to, PM_CAPTURE));
+				}
+
+				if(board->enPassant != 0 && (PAWN_ATTACKS[color - 1][from] & BB_LOCATION(board->enPassant)))
+				{
+					const PackedMove move = PM_PACK(from, location_getindex(board->enPassant), PM_ENPASSANT);
+
+					if(move_is_legal(board, &info, move))
+						ret += add(buffer, move);
+				}
+
+				continue;
+			}
+			case PIECE_KNIGHT:
+				targets = KNIGHT_ATTACKS[from];
+				break;
+			case PIECE_BISHOP:
+				targets = bishop_attacks(from, occupancy);
+				break;
+			case PIECE_ROOK:
+				targets = rook_attacks(from, occupancy);
+				break;
+			case PIECE_QUEEN:
+				targets = queen_attacks(from, occupancy);
+				break;
+			default:
+				targets = BB_EMPTY;
+		}
+
+		targets &= ~own & allowed;
+		while(!(firstOnly && ret) && targets != BB_EMPTY)
+		{
+			const uint_fast8_t to = bitboard_first(targets);
+			targets &= targets - 1;
+
+			ret += add(buffer, PM_PACK(from, to, enemy & BB_SQUARE(to) ? PM_CAPTURE : PM_QUIET));
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * Fills a buffer with every legal move one side can make in the current position.
+ *
+ * @param board   The game instance being played
+ * @param color   The color whose moves are generated
+ * @param buffer  The buffer the moves are written to. Its old contents are discarded
+ */
+void generate_legal_moves(Game *board, int_fast8_t color, MoveBuffer *buffer)
+{
+	generate(board, color, buffer, false);
+}
+
+/**
+ * Determines if one side has any legal move at all. Stops at the first one found,
+ * so it's much cheaper than generating every move when checking for mate or stalemate.
+ *
+ * @param board  The game instance being played
+ * @param color  The color being tested
+ *
+ * @return true if color can move
+ */
+bool has_any_legal_move(Game *board, int_fast8_t color)
+{
+	return generate(board, color, NULL, true) != 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MOVEGEN_H_INCLUDED
+#define MOVEGEN_H_INCLUDED
+
+#include "chess.h"
+
+typedef struct
+{
+	uint_fast16_t count;
+	PackedMove moves[MOVEBUFFER_SIZE];
+} MoveBuffer;
+
+typedef struct
+{
+	Bitboard checkers;			/* the enemy pieces giving check */
+	Bitboard evasions;			/* the squares any move but a king move has to end on */
+	Bitboard pinned;			/* the pieces that can only move along the line to their king */
+	Bitboard pinRays[64];		/* for each pinned piece, the line from its king up to and including its pinner. Other entries aren't set */
+	uint_fast8_t king;			/* the king's square */
+	int_fast8_t color;
+} CheckInfo;
+
+Bitboard attackers_to(Game*, uint_fast8_t, int_fast8_t, Bitboard);
+bool square_is_attacked(Game*, uint_fast8_t, int_fast8_t);
+void check_info(Game*, int_fast8_t, CheckInfo*);
+bool move_is_legal(Game*, const CheckInfo*, PackedMove);
+bool gives_check(Game*, int_fast8_t, PackedMove);
+bool can_castle(Game*, int_fast8_t, bool);
+
+void generate_legal_moves(Game*, int_fast8_t, MoveBuffer*);
+bool has_any_legal_move(Game*, int_fast8_t);
+
+#endif /* MOVEGEN_H_INCLUDED */
@@ -0,0 +1,174 @@
+#include "perft.h"
+#include "fen.h"
+#include "makemove.h"
+
+/*
+ * Perft walks the tree of legal moves to a fixed depth and counts the leaves. The counts
+ * for well known positions have been verified by many engines, so matching them is a very
+ * strong test of the move generator, and timing the walk measures how fast it is.
+ */
+
+typedef struct
+{
+	const char *name;
+	const char *fen;
+	uint_fast8_t depth;
+	uintmax_t nodes;
+} PerftPosition;
+
+/* https://www.chessprogramming.org/Perft_Results */
+static const PerftPosition REFERENCE_POSITIONS[] =
+{
+	{"Initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+	{"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+	{"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+	{"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+	{"Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+	{"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594}
+};
+
+/**
+ * Counts the number of leaf nodes in the tree of legal moves.
+ *
+ * @param board  The game instance being played. It is left as it was found
+ * @param color  The color whose turn it is
+ * @param depth  How many plies deep to search
+ *
+ * @return the number of move sequences of length depth
+ */
+uintmax_t perft(Game *board, int_fast8_t color, uint_fast8_t depth)
+{
+	MoveBuffer buffer;
+	uintmax_t ret;
+	uint_fast16_t i;
+
+	if(depth == 0) return 1;
+
+	generate_legal_moves(board, color, &buffer);
+
+	/* The moves at the last ply don't have to be made to be counted */
+	if(depth == 1) return buffer.count;
+
+	ret = 0;
+	for(i = 0; i < buffer.count; i++)
+	{
+		Undo undo;
+
+		make_move(board, buffer.moves[i], &undo);
+		ret += perft(board, color == TEAM_WHITE ? TEAM_BLACK : TEAM_WHITE, depth - 1);
+		unmake_move(board, &undo);
+	}
+
+	return ret;
+}
+
+/**
+ * Writes a move in coordinate notation, e.g. "e2e4" or "a7a8q".
+ */
+static void move_to_coordinates(char *dest, PackedMove move)
+{
+	const char promotions[4] = {'n', 'b', 'r', 'q'};
+
+	location_to_coordinate_string(dest, location_from_index(PM_FROM(move)));
+	location_to_coordinate_string(dest + 2, location_from_index(PM_TO(move)));
+
+	if(PM_FLAGS(move) & PM_PROMOTION)
+	{
+		dest[4] = promotions[PM_FLAGS(move) & PM_PROMOTIONMASK];
+		dest[5] = '\0';
+	}
+}
+
+static void print_speed(uintmax_t nodes, clock_t start)
+{
+	const double seconds = ((double) (clock() - start)) / CLOCKS_PER_SEC;
+
+	printf("%" PRIuMAX " nodes in %.3lfs", nodes, seconds);
+	if(seconds > 0) printf(" (%.0lf nodes/s)", nodes / seconds);
+	printf("\n");
+}
+
+/**
+ * Prints the perft count below each legal move, then the total. Comparing this against
+ * another engine's output narrows a wrong count down to the move that causes it.
+ *
+ * @param board  The game instance being played
+ * @param color  The color whose turn it is
+ * @param depth  How many plies deep to search
+ */
+void divide(Game *board, int_fast8_t color, uint_fast8_t depth)
+{
+	MoveBuffer buffer;
+	uintmax_t total;
+	uint_fast16_t i;
+	clock_t start;
+
+	start = clock();
+	total = 0;
+
+	generate_legal_moves(board, color, &buffer);
+	for(i = 0; depth > 0 && i < buffer.count; i++)
+	{
+		Undo undo;
+		uintmax_t nodes;
+		char coords[6];
+
+		make_move(board, buffer.moves[i], &undo);
+		nodes = perft(board, color == TEAM_WHITE ? TEAM_BLACK : TEAM_WHITE, depth - 1);
+		unmake_move(board, &undo);
+
+		move_to_coordinates(coords, buffer.moves[i]);
+		printf("%s: %" PRIuMAX "\n", coords, nodes);
+
+		total += nodes;
+	}
+
+	printf("\n");
+	print_speed(depth > 0 ? total : 1, start);
+}
+
+/**
+ * Runs perft on the reference positions and compares the counts to the known ones.
+ *
+ * @return true if every count matched
+ */
+bool perft_suite()
+{
+	const uint_fast8_t count = sizeof(REFERENCE_POSITIONS) / sizeof(REFERENCE_POSITIONS[0]);
+	uintmax_t totalNodes;
+	uint_fast8_t i;
+	clock_t start;
+	bool ret;
+
+	ret = true;
+	totalNodes = 0;
+	start = clock();
+
+	for(i = 0; i < count; i++)
+	{
+		const PerftPosition *pos = &REFERENCE_POSITIONS[i];
+		Game *board = init_game();
+		int_fast8_t color = load_fen(board, pos->fen);
+		uintmax_t nodes;
+		clock_t posStart;
+
+		assert(color != 0);
+
+		posStart = clock();
+		nodes = perft(board, color, pos->depth);
+
+		printf("%-18s depth %" PRIuFAST8 ": %s ", pos->name, pos->depth, nodes == pos->nodes ? "ok  " : "FAIL");
+		print_speed(nodes, posStart);
+		if(nodes != pos->nodes) printf("\texpected %" PRIuMAX "\n", pos->nodes);
+
+		ret = ret && nodes == pos->nodes;
+		totalNodes += nodes;
+
+		free_game(board);
+	}
+
+	printf("\nTotal: ");
+	print_speed(totalNodes, start);
+
+	return ret;
+}
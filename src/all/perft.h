@@ -0,0 +1,10 @@
+#ifndef PERFT_H_INCLUDED
+#define PERFT_H_INCLUDED
+
+#include "movegen.h"
+
+uintmax_t perft(Game*, int_fast8_t, uint_fast8_t);
+void divide(Game*, int_fast8_t, uint_fast8_t);
+bool perft_suite();
+
+#endif /* PERFT_H_INCLUDED */
@@ -0,0 +1,295 @@
+#define _POSIX_C_SOURCE 200112L    /* for stat() */
+
+#include <sys/stat.h>
+
+#include "pgnindex.h"
+
+/*
+ * A PGN file that holds many games gets an index the first time it's opened, written
+ * next to it as <file>.idx. Opening a game by its number then reads one fixed size record
+ * and the game's tag pairs out of the index and goes straight to the game, rather than
+ * reading every game in front of it. The index remembers the size and modification time
+ * the PGN file had when it was made, and is made again if either of them changes.
+ *
+ * Every number in the index is 8 bytes, least significant first, so one made on one
+ * machine can be read on another. It's laid out as
+ *
+ *     PGN_INDEX_MAGIC, the PGN file's size, its modification time, the number of games,
+ *     where the records start
+ *     each game's tag pairs, as Name\0Value\0 ... and an empty name to end them
+ *     each game's record: where it starts, how long it is and where its tag pairs are
+ */
+
+#define PGN_INDEX_MAGIC     "PGNIDX1"   /* with its null terminator it's the index's first 8 bytes */
+#define PGN_INDEX_HEADER    48          /* the magic and 5 numbers */
+#define PGN_INDEX_RECORD    24          /* 3 numbers */
+
+static void index_put(FILE *fp, uint_least64_t n)
+{
+	uint_fast8_t i;
+
+	for(i = 0; i < 8; i++)
+		fputc((int) ((n >> (8 * i)) & 0xff), fp);
+}
+
+static uint_least64_t index_get(FILE *fp)
+{
+	uint_least64_t n = 0;
+	uint_fast8_t i;
+
+	for(i = 0; i < 8; i++)
+	{
+		int c = fgetc(fp);
+
+		if(c == EOF) return 0;
+		n |= ((uint_least64_t) (c & 0xff)) << (8 * i);
+	}
+
+	return n;
+}
+
+/* Whether a token is the result at the end of a game */
+static bool slice_is_result(Slice token)
+{
+	char str[RESULT_LENGTH];
+
+	return token.length < RESULT_LENGTH && slice_copy(str, RESULT_LENGTH, token) == token.length && string_matches_end(str);
+}
+
+/*
+ * Writes the name and value of a tag pair like [White "Morphy, Paul"] to the index, as long
+ * as they fit in the game's PGN_TAGS_LENGTH along with the ones before them. used is how much
+ * of that the game has used so far. Returns how many chars were written.
+ */
+static uintmax_t index_tag(FILE *fp, Slice token, uintmax_t *used)
+{
+	uintmax_t nameEnd, valueStart, valueEnd, i;
+
+	for(nameEnd = 1; nameEnd < token.length; nameEnd++)
+		if(token.str[nameEnd] <= ' ' || token.str[nameEnd] == '"' || token.str[nameEnd] == ']') break;
+
+	/* The value is everything between the first and last quotes, escaped quotes included */
+	for(valueStart = nameEnd; valueStart < token.length && token.str[valueStart] != '"'; valueStart++);
+	for(valueEnd = token.length - 1; valueEnd > valueStart && token.str[valueEnd] != '"'; valueEnd--);
+	if(valueStart++ >= valueEnd) valueStart = valueEnd = 0;
+
+	/* One more char is kept for the empty name at the end */
+	if(nameEnd == 1 || *used + (nameEnd - 1) + (valueEnd - valueStart) + 3 > PGN_TAGS_LENGTH) return 0;
+
+	fwrite(token.str + 1, sizeof(char), nameEnd - 1, fp);
+	fputc('\0', fp);
+	fwrite(token.str + valueStart, sizeof(char), valueEnd - valueStart, fp);
+	fputc('\0', fp);
+
+	i = (nameEnd - 1) + (valueEnd - valueStart) + 2;
+	*used += i;
+
+	return i;
+}
+
+/*
+ * Reads through the whole PGN file and writes its index to fp. A game starts at the first tag
+ * pair or move after the one before it, and ends with its result or the end of the file.
+ * Returns false if the file couldn't be read or the index couldn't be written.
+ */
+static bool index_build(FILE *fp, const char *filename, const struct stat *st)
+{
+	PGNReader reader;
+	Slice token;
+	uint_least64_t *records = NULL;
+	uintmax_t count = 0, capacity = 0, at = PGN_INDEX_HEADER, used = 0, i;
+	bool inGame = false;
+
+	if(!pgn_open(&reader, filename)) return false;
+	reader.tags = true;
+
+	fseek(fp, PGN_INDEX_HEADER, SEEK_SET);
+
+	for(;;)
+	{
+		bool more = pgn_next_token(&reader, &token);
+
+		if(more && !inGame)
+		{
+			if(count == capacity)
+			{
+				capacity = capacity == 0 ? 1024 : 2 * capacity;
+				records = realloc(records, 3 * capacity * sizeof(uint_least64_t));
+				assert(records != NULL);
+			}
+
+			records[3 * count] = pgn_offset(&reader, token.str);
+			records[3 * count + 2] = at;
+			used = 0;
+			inGame = true;
+		}
+
+		if(more && token.str[0] == '[')
+			at += index_tag(fp, token, &used);
+		else if(inGame && (!more || slice_is_result(token)))
+		{
+			const char *end = more ? token.str + token.length : reader.buffer + reader.pos;
+
+			records[3 * count + 1] = pgn_offset(&reader, end) - records[3 * count];
+			fputc('\0', fp);
+			at++;
+			count++;
+			inGame = false;
+		}
+
+		if(!more) break;
+	}
+
+	pgn_close(&reader);
+
+	for(i = 0; i < 3 * count; i++)
+		index_put(fp, records[i]);
+	free(records);
+
+	rewind(fp);
+	fwrite(PGN_INDEX_MAGIC, sizeof(char), sizeof(PGN_INDEX_MAGIC), fp);
+	index_put(fp, st->st_size);
+	index_put(fp, st->st_mtime);
+	index_put(fp, count);
+	index_put(fp, at);
+
+	return fflush(fp) == 0 && !ferror(fp);
+}
+
+/* Reads the index's header. Returns false if it isn't an index of the file st describes as it is now */
+static bool index_is_current(PGNIndex *index, const struct stat *st)
+{
+	char magic[sizeof(PGN_INDEX_MAGIC)];
+	uint_least64_t size, mtime;
+
+	rewind(index->fp);
+
+	if(fread(magic, sizeof(char), sizeof(magic), index->fp) != sizeof(magic) || memcmp(magic, PGN_INDEX_MAGIC, sizeof(magic)) != 0)
+		return false;
+
+	size = index_get(index->fp);
+	mtime = index_get(index->fp);
+	index->count = index_get(index->fp);
+	index->records = index_get(index->fp);
+
+	return size == (uint_least64_t) st->st_size && mtime == (uint_least64_t) st->st_mtime && !ferror(index->fp);
+}
+
+/**
+ * Opens the index of a PGN file, making it first if it doesn't exist yet or if the file has
+ * changed since it was made. If it can't be written next to the file it's only kept until
+ * it's closed.
+ *
+ * @param index     The index being opened
+ * @param filename  Name of the PGN file
+ *
+ * @return false if the PGN file couldn't be read
+ */
+bool pgn_index_open(PGNIndex *index, const char *filename)
+{
+	struct stat st;
+	char *indexname;
+	bool ok = true;
+
+	if(stat(filename, &st) != 0) return false;
+
+	indexname = malloc((string_getlen(filename) + 5) * sizeof(char));
+	assert(indexname != NULL);
+	string_copy(indexname, filename);
+	string_concatenate(indexname, ".idx");
+
+	index->temporary = false;
+	index->fp = fopen(indexname, "rb");
+	if(index->fp != NULL && !index_is_current(index, &st))
+	{
+		fclose(index->fp);
+		index->fp = NULL;
+	}
+
+	if(index->fp == NULL)
+	{
+		index->fp = fopen(indexname, "w+b");
+		if(index->fp != NULL && !index_build(index->fp, filename, &st))
+		{
+			fclose(index->fp);
+			remove(indexname);
+			index->fp = NULL;
+		}
+
+		if(index->fp == NULL)
+		{
+			index->fp = tmpfile();
+			index->temporary = true;
+			ok = index->fp != NULL && index_build(index->fp, filename, &st);
+		}
+
+		ok = ok && index_is_current(index, &st);
+	}
+
+	free(indexname);
+
+	if(!ok && index->fp != NULL)
+	{
+		fclose(index->fp);
+		index->fp = NULL;
+	}
+
+	return ok;
+}
+
+void pgn_index_close(PGNIndex *index)
+{
+	if(index->fp != NULL) fclose(index->fp);
+	index->fp = NULL;
+}
+
+/**
+ * Looks a game up in the index without reading any of the games in front of it.
+ *
+ * @param index   The PGN file's index
+ * @param number  Which game, counting from 1
+ * @param game    Set to where the game is and what its tag pairs are
+ *
+ * @return false if the file doesn't have that many games
+ */
+bool pgn_index_game(PGNIndex *index, uintmax_t number, PGNGame *game)
+{
+	uintmax_t tags, got;
+
+	if(number == 0 || number > index->count) return false;
+
+	fseek(index->fp, index->records + (number - 1) * PGN_INDEX_RECORD, SEEK_SET);
+	game->number = number;
+	game->offset = index_get(index->fp);
+	game->length = index_get(index->fp);
+	tags = index_get(index->fp);
+
+	/* The tag pairs were cut short when the index was made so they all fit */
+	fseek(index->fp, tags, SEEK_SET);
+	got = fread(game->tags, sizeof(char), PGN_TAGS_LENGTH, index->fp);
+	game->tags[got < PGN_TAGS_LENGTH ? got : PGN_TAGS_LENGTH - 1] = '\0';
+
+	return !ferror(index->fp);
+}
+
+/**
+ * @param game  A game looked up with pgn_index_game()
+ * @param name  The name of a tag pair, e.g. White
+ *
+ * @return the tag pair's value, or NULL if the game doesn't have it
+ */
+const char *pgn_tag(const PGNGame *game, const char *name)
+{
+	const char *tag = game->tags;
+
+	while(*tag != '\0')
+	{
+		const char *value = tag + string_getlen(tag) + 1;
+
+		if(string_matches(tag, name)) return value;
+
+		tag = value + string_getlen(value) + 1;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef PGNINDEX_H_INCLUDED
+#define PGNINDEX_H_INCLUDED
+
+#include "filereading.h"
+
+/* Where each game in a PGN file is, kept in a file next to it. See pgn_index_open() */
+typedef struct
+{
+	FILE *fp;
+	uintmax_t count;        /* how many games the PGN file holds */
+	uintmax_t records;      /* where in the index the games' records start */
+	bool temporary;         /* true if it couldn't be written next to the PGN file, so it's gone once it's closed */
+} PGNIndex;
+
+/* One game of a PGN file as the index has it */
+typedef struct
+{
+	uintmax_t number;       /* counting from 1 */
+	uintmax_t offset;       /* where in the PGN file the game starts */
+	uintmax_t length;       /* how many chars it takes up, up to and including its result */
+	char tags[PGN_TAGS_LENGTH]; /* Name\0Value\0 for each tag pair, then an empty name */
+} PGNGame;
+
+bool pgn_index_open(PGNIndex*, const char*);
+void pgn_index_close(PGNIndex*);
+bool pgn_index_game(PGNIndex*, uintmax_t, PGNGame*);
+
+const char *pgn_tag(const PGNGame*, const char*);
+
+#endif /* PGNINDEX_H_INCLUDED */
@@ -100,81 +100,37 @@ char get_piece_icon(Piece p)
 }
 
 /**
- * Puts all of the pieces in black and white into a single array.
+ * Converts a PGN piece symbol into the piece type macro it represents.
  *
- * @param board   The game instance being played
+ * @param c   The piece symbol ('N', 'B', 'R', 'Q', or 'K')
  *
- * @return        An array containing every piece belonging to both sides
+ * @return    The type of piece c represents. PIECE_PAWN if it isn't a piece symbol
  */
-void get_all_pieces(Piece *All[], Piece *White[], Piece *Black[])
+uint_fast8_t piece_type_from_symbol(char c)
 {
-	uint_fast8_t i, j;
+	uint_fast8_t ret;
 
-	for(i = 0, j = 0; i < PIECES_PER_SIDE; i++, j++)
+	switch(c)
 	{
-		All[i] = White[j];
-		All[i + PIECES_PER_SIDE] = Black[j];
+		case 'N':
+			ret = PIECE_KNIGHT;
+			break;
+		case 'B':
+			ret = PIECE_BISHOP;
+			break;
+		case 'R':
+			ret = PIECE_ROOK;
+			break;
+		case 'Q':
+			ret = PIECE_QUEEN;
+			break;
+		case 'K':
+			ret = PIECE_KING;
+			break;
+		default:
+			ret = PIECE_PAWN;
 	}
-}
-
-/**
- * Returns a pointer to the piece that resides at the given location.
- *
- * @param all    An array containing all of the pieces
- * @param loc    The location where a piece should be
- *
- * @returns the piece at loc
- */
-Piece *piece_at(Piece **all, Location loc)
-{
-	uint_fast8_t i;
-	Piece *ret = NULL;
-
-	for(i = 0; ret == NULL && i < 2 * PIECES_PER_SIDE; i++)
-		if(all[i]->currentLocation != 0 && all[i]->currentLocation == loc)
-			ret = all[i];
 
 	return ret;
 }
 
-/**
- * Determines if a piece is a valid candidate for promotion and
- * is promoted if it is.
- *
- * @param p 			The candidate for promotion
- * @param analString	Move string being analyzed
- */
-char piece_promoted(Piece *p, const char *analString)
-{
-	char ret = 0;
-
-	uint_fast8_t endVert = p->color == TEAM_WHITE ? 8 : 1;
-	if(p->type == PIECE_PAWN && p->currentLocation != 0 && location_getrank(p->currentLocation) == endVert)
-	{
-		uint_fast8_t i;
-		char pieces[4] = {'N', 'R', 'B', 'Q'};
-
-		ret = 'Q';
-		for(i = 0; ret == 'Q' && i < 4; i++)
-			if(string_contains(analString, pieces[i]))
-				ret = pieces[i];
-
-		switch(ret)
-		{
-			case 'Q':
-				p->type = PIECE_QUEEN;
-				break;
-			case 'R':
-				p->type = PIECE_ROOK;
-				break;
-			case 'N':
-				p->type = PIECE_KNIGHT;
-				break;
-			case 'B':
-				p->type = PIECE_BISHOP;
-				break;
-		}
-	}
-
-	return ret;
-}
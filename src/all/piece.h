@@ -1,24 +1,22 @@
 #ifndef PIECE_H_INCLUDED
 #define PIECE_H_INCLUDED
 
-#include "location.h"
+#include "bitboard.h"
 #include "macros.h"
 
 typedef struct piece
 {
     uint_fast8_t color;
     uint_fast8_t type;
-    bool hasMoved;
     Location currentLocation;
+    Bitboard attacks;           /* every square the piece attacks, kept up to date by relocate() */
 } Piece;
 
 
-char piece_promoted(Piece*, const char*);
+uint_fast8_t piece_type_from_symbol(char);
 char *get_piece_name(Piece*);
 char get_piece_symbol(Piece*);
 char get_piece_icon(Piece);
-void get_all_pieces(Piece*[], Piece*[], Piece*[]);
 
-Piece *piece_at(Piece**, Location);
 
 #endif /* PIECE_H_INCLUDED */
@@ -0,0 +1,68 @@
+#include "replay.h"
+
+/*
+ * Plays the moves of a game straight out of a PGN file, one after another, without showing
+ * the board or waiting on anyone in between. It's how files of games are checked: every
+ * move has to be legal where it's played.
+ */
+
+/**
+ * Plays a game's moves from a PGN file until its result, the end of the file or a move that
+ * can't be played.
+ *
+ * @param board   The game the moves are played in, usually one that was just reset
+ * @param reader  The file, just before the game's first move
+ * @param replay  Set to how it went
+ *
+ * @return false if a move couldn't be played
+ */
+bool replay_game(Game *board, PGNReader *reader, Replay *replay)
+{
+	const clock_t start = clock();
+	Slice token;
+
+	replay->plies = 0;
+	replay->illegal[0] = '\0';
+	string_copy(replay->result, "*");
+
+	while(pgn_next_token(reader, &token))
+	{
+		char move[PLY_INPUT_LENGTH];
+		bool tooLong = token.length >= PLY_INPUT_LENGTH;   /* then it isn't a move or a result */
+
+		slice_copy(move, PLY_INPUT_LENGTH, token);
+
+		if(!tooLong && string_matches_end(move))
+		{
+			string_copy(replay->result, move);
+			set_result(&(board->Moves), move);
+			break;
+		}
+
+		if(tooLong || !process_move(board, move, 0))
+		{
+			string_copy(replay->illegal, move);
+			break;
+		}
+
+		replay->plies++;
+	}
+
+	replay->seconds = ((double) (clock() - start)) / CLOCKS_PER_SEC;
+
+	return replay->illegal[0] == '\0';
+}
+
+/**
+ * Prints a one line summary of a replay: the result, how many plies were played and how
+ * long they took.
+ *
+ * @param replay  The replay, as replay_game() left it
+ */
+void print_replay(const Replay *replay)
+{
+	printf("%s in %" PRIuMAX " plies, %.3lfms", replay->result, replay->plies, replay->seconds * 1000);
+	if(replay->plies > 0) printf(" (%.2lfus per ply)", replay->seconds * 1000000 / replay->plies);
+	if(replay->illegal[0] != '\0') printf(", stopped at illegal move %s", replay->illegal);
+	printf("\n");
+}
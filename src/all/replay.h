@@ -0,0 +1,19 @@
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+#include "chess.h"
+#include "filereading.h"
+
+/* How replaying a game from a PGN file went, see replay_game() */
+typedef struct
+{
+	uintmax_t plies;                /* how many moves were played */
+	char result[RESULT_LENGTH];     /* the result the file gives the game, * if it doesn't give one */
+	char illegal[PLY_INPUT_LENGTH]; /* the move that couldn't be played, empty if they all could */
+	double seconds;
+} Replay;
+
+bool replay_game(Game*, PGNReader*, Replay*);
+void print_replay(const Replay*);
+
+#endif /* REPLAY_H_INCLUDED */
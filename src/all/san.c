@@ -0,0 +1,417 @@
+#include "san.h"
+#include "logichelp.h"
+#include "makemove.h"
+#include "movegen.h"
+
+/*
+ * Moves are read in one pass over their standard algebraic notation. Every char is looked up
+ * in SAN_CLASSES to find out what it can be, and the SAN is taken apart into a SanMove:
+ * the type of piece, whatever file and rank it's said to come from, where it lands, what
+ * it promotes to and whether it's a capture, check or mate. That's then matched against
+ * the legal moves of the position, so any number of pieces of a type (three knights after
+ * a promotion, say) are told apart the same way, and a move that matches none or more
+ * than one of them isn't a move.
+ */
+
+#define SC_NONE     0   /* can't be in a SAN */
+#define SC_FILE     1   /* a to h */
+#define SC_RANK     2   /* 1 to 8 */
+#define SC_PIECE    3   /* N B R Q K */
+#define SC_TAKE     4   /* x or : */
+#define SC_PROMO    5   /* = */
+#define SC_CHECK    6   /* + */
+#define SC_MATE     7   /* # */
+#define SC_CASTLE   8   /* O or 0 */
+#define SC_DASH     9   /* - in a castle, or between squares in long algebraic notation */
+#define SC_GLYPH    10  /* ! or ? after a move */
+
+/* What each char can be by its ASCII code. Anything past 127 can't be in a SAN */
+static const uint_least8_t SAN_CLASSES[128] =
+{
+	/* control chars */
+	SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE,
+	SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE,
+	SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE,
+	SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE, SC_NONE,
+	/*  space     !         "         #         $         %         &         '   */
+	SC_NONE,  SC_GLYPH, SC_NONE,  SC_MATE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,
+	/*  (         )         *         +         ,         -         .         /   */
+	SC_NONE,  SC_NONE,  SC_NONE,  SC_CHECK, SC_NONE,  SC_DASH,  SC_NONE,  SC_NONE,
+	/*  0         1         2         3         4         5         6         7   */
+	SC_CASTLE, SC_RANK, SC_RANK,  SC_RANK,  SC_RANK,  SC_RANK,  SC_RANK,  SC_RANK,
+	/*  8         9         :         ;         <         =         >         ?   */
+	SC_RANK,  SC_NONE,  SC_TAKE,  SC_NONE,  SC_NONE,  SC_PROMO, SC_NONE,  SC_GLYPH,
+	/*  @         A         B         C         D         E         F         G   */
+	SC_NONE,  SC_NONE,  SC_PIECE, SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,
+	/*  H         I         J         K         L         M         N         O   */
+	SC_NONE,  SC_NONE,  SC_NONE,  SC_PIECE, SC_NONE,  SC_NONE,  SC_PIECE, SC_CASTLE,
+	/*  P         Q         R         S         T         U         V         W   */
+	SC_NONE,  SC_PIECE, SC_PIECE, SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,
+	/*  X         Y         Z         [         \         ]         ^         _   */
+	SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,
+	/*  `         a         b         c         d         e         f         g   */
+	SC_NONE,  SC_FILE,  SC_FILE,  SC_FILE,  SC_FILE,  SC_FILE,  SC_FILE,  SC_FILE,
+	/*  h         i         j         k         l         m         n         o   */
+	SC_FILE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,
+	/*  p         q         r         s         t         u         v         w   */
+	SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,
+	/*  x         y         z         {         |         }         ~        DEL  */
+	SC_TAKE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE,  SC_NONE
+};
+
+/* What a pawn becomes by the lowest 2 bits of a promotion's PM_ flags */
+static const uint_least8_t SAN_PROMOTIONS[4] = { PIECE_KNIGHT, PIECE_BISHOP, PIECE_ROOK, PIECE_QUEEN };
+
+/* The SAN_CLASSES entry of a char */
+static uint_fast8_t san_class(char c)
+{
+	return (unsigned char) c < 128 ? SAN_CLASSES[(unsigned char) c] : SC_NONE;
+}
+
+/**
+ * Takes a move in standard algebraic notation apart, e.g. Nbxd7+, exd8=Q#, O-O-O or e4!?.
+ * Only the notation is looked at, not the position, so it says nothing about whether the
+ * move can be played. A capture doesn't have to be marked with an x.
+ *
+ * @param str  The SAN. It doesn't have to be null terminated
+ * @param san  Set to the parts of the move
+ *
+ * @return false if str isn't a move in SAN
+ */
+bool san_parse(Slice str, SanMove *san)
+{
+	uint_least8_t classes[4], values[4];
+	uint_fast8_t coords = 0;
+	uintmax_t i = 0;
+
+	san->type = PIECE_PAWN;
+	san->fromFile = SAN_ANY;
+	san->fromRank = SAN_ANY;
+	san->to = 0;
+	san->promotion = PIECE_PAWN;
+	san->flags = 0;
+
+	if(str.length > 0 && san_class(str.str[0]) == SC_CASTLE)
+	{
+		uint_fast8_t castles = 0;
+
+		/* O-O or O-O-O, the Os joined by dashes */
+		for(;;)
+		{
+			castles++;
+			i++;
+
+			if(i + 1 < str.length && san_class(str.str[i]) == SC_DASH && san_class(str.str[i + 1]) == SC_CASTLE)
+				i++;
+			else
+				break;
+		}
+
+		if(castles == 2)
+			san->flags = SAN_CASTLE_KINGSIDE;
+		else if(castles == 3)
+			san->flags = SAN_CASTLE_QUEENSIDE;
+		else
+			return false;
+	}
+	else
+	{
+		if(i < str.length && san_class(str.str[i]) == SC_PIECE)
+			san->type = piece_type_from_symbol(str.str[i++]);
+
+		/* The squares, as up to 2 files and 2 ranks with maybe an x or a - somewhere between them */
+		for(; i < str.length; i++)
+		{
+			const uint_fast8_t class = san_class(str.str[i]);
+
+			if(class == SC_FILE || class == SC_RANK)
+			{
+				if(coords == 4) return false;
+
+				classes[coords] = class;
+				values[coords++] = class == SC_FILE ? str.str[i] - 'a' : str.str[i] - '1';
+			}
+			else if(class == SC_TAKE)
+				san->flags |= SAN_CAPTURE;
+			else if(class != SC_DASH)
+				break;
+		}
+
+		/* The last file and rank are where it lands, anything before them is where it's from */
+		if(coords < 2 || classes[coords - 2] != SC_FILE || classes[coords - 1] != SC_RANK) return false;
+
+		san->to = values[coords - 1] * 8 + values[coords - 2];
+
+		if(coords == 3)
+		{
+			if(classes[0] == SC_FILE)
+				san->fromFile = values[0];
+			else
+				san->fromRank = values[0];
+		}
+		else if(coords == 4)
+		{
+			if(classes[0] != SC_FILE || classes[1] != SC_RANK) return false;
+
+			san->fromFile = values[0];
+			san->fromRank = values[1];
+		}
+
+		/* e8=Q, or e8Q as some write it */
+		if(i < str.length && san->type == PIECE_PAWN && (san_class(str.str[i]) == SC_PROMO || san_class(str.str[i]) == SC_PIECE))
+		{
+			if(san_class(str.str[i]) == SC_PROMO) i++;
+
+			if(i == str.length || san_class(str.str[i]) != SC_PIECE || str.str[i] == 'K') return false;
+
+			san->promotion = piece_type_from_symbol(str.str[i++]);
+		}
+	}
+
+	/* Check, mate, and any ! or ? that comment on the move */
+	for(; i < str.length; i++)
+	{
+		const uint_fast8_t class = san_class(str.str[i]);
+
+		if(class == SC_CHECK)
+			san->flags |= SAN_CHECK;
+		else if(class == SC_MATE)
+			san->flags |= SAN_MATE;
+		else if(class != SC_GLYPH)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Finds the legal move a SAN stands for in the position. A pawn that reaches the last rank
+ * without saying what it becomes becomes a queen. A move marked as a capture has to be one.
+ *
+ * @param board  The game instance being played. The move is for the side whose turn it is
+ * @param san    The move, as san_parse() took it apart
+ *
+ * @return the move, or PM_NONE if no legal move or more than one of them matches san
+ */
+PackedMove san_resolve(Game *board, const SanMove *san)
+{
+	const Bitboard movers = board->typeBoards[TYPE_INDEX(san->type)] & board->occupied[board->toMove];
+	const uint_fast8_t promotion = san->promotion == PIECE_PAWN ? PIECE_QUEEN : san->promotion;
+	PackedMove found = PM_NONE;
+	MoveBuffer legal;
+	uint_fast16_t i;
+
+	generate_legal_moves(board, board->toMove, &legal);
+
+	for(i = 0; i < legal.count; i++)
+	{
+		const PackedMove move = legal.moves[i];
+		const uint_fast8_t from = PM_FROM(move), flags = PM_FLAGS(move);
+		const bool castle = flags == PM_CASTLE_KINGSIDE || flags == PM_CASTLE_QUEENSIDE;
+
+		if(san->flags & SAN_CASTLE)
+		{
+			if(flags == (san->flags & SAN_CASTLE_KINGSIDE ? PM_CASTLE_KINGSIDE : PM_CASTLE_QUEENSIDE))
+				return move;
+
+			continue;
+		}
+
+		if(castle || PM_TO(move) != san->to || !(movers & BB_SQUARE(from)))
+			continue;
+
+		/* A pawn that doesn't say which file it's from is pushed straight up its own */
+		if(san->fromFile != SAN_ANY ? from % 8 != san->fromFile : san->type == PIECE_PAWN && from % 8 != san->to % 8)
+			continue;
+		if(san->fromRank != SAN_ANY && from / 8 != san->fromRank)
+			continue;
+
+		if(flags & PM_PROMOTION ? SAN_PROMOTIONS[flags & PM_PROMOTIONMASK] != promotion : san->promotion != PIECE_PAWN)
+			continue;
+
+		/* A capture doesn't have to be marked with an x, but an x has to be a capture. En passant's flags have PM_CAPTURE in them */
+		if((san->flags & SAN_CAPTURE) && !(flags & PM_CAPTURE))
+			continue;
+
+		/* It's ambiguous */
+		if(found != PM_NONE) return PM_NONE;
+
+		found = move;
+	}
+
+	return found;
+}
+
+/**
+ * Works out the PLY_ notes a move's standard algebraic notation needs, before the move is
+ * played: the type of the piece, whether its file, rank or both tell it apart from the others
+ * of its type that could legally go to the same square, and whether it checks or mates.
+ *
+ * @param board  The game instance being played. The move is for the side whose turn it is
+ * @param move   A legal move
+ *
+ * @return the notes, for ply_to_PGN() to write the SAN from
+ */
+uint_fast8_t san_notes(Game *board, PackedMove move)
+{
+	const uint_fast8_t from = PM_FROM(move), to = PM_TO(move);
+	const int_fast8_t color = board->toMove;
+	const Piece *mover = piece_on(board, from);
+	uint_fast8_t notes = TYPE_INDEX(mover->type);
+
+	/* A pawn's capture already gives its file, and there's only one king */
+	if(mover->type != PIECE_PAWN && mover->type != PIECE_KING)
+	{
+		Bitboard others = attackers_to(board, to, color, board->occupied[0]) & board->typeBoards[TYPE_INDEX(mover->type)] & ~BB_SQUARE(from);
+
+		if(others != BB_EMPTY)
+		{
+			bool ambiguous = false, sameFile = false, sameRank = false;
+			CheckInfo info;
+
+			/* A piece that's pinned, or can't stop a check from there, doesn't count */
+			check_info(board, color, &info);
+
+			for(; others != BB_EMPTY; others &= others - 1)
+			{
+				const uint_fast8_t other = bitboard_first(others);
+
+				if(move_is_legal(board, &info, PM_PACK(other, to, PM_FLAGS(move))))
+				{
+					ambiguous = true;
+					sameFile |= other % 8 == from % 8;
+					sameRank |= other / 8 == from / 8;
+				}
+			}
+
+			if(ambiguous)
+			{
+				if(!sameFile)
+					notes |= PLY_FILESPECIFIED;
+				else if(!sameRank)
+					notes |= PLY_RANKSPECIFIED;
+				else
+					notes |= PLY_FILESPECIFIED | PLY_RANKSPECIFIED;
+			}
+		}
+	}
+
+	/* Only a move that checks has to be played to see if it mates */
+	if(gives_check(board, color, move))
+	{
+		Undo undo;
+
+		notes |= PLY_CHECK;
+
+		make_move(board, move, &undo);
+		if(!has_any_legal_move(board, board->toMove)) notes |= PLY_MATE;
+		unmake_move(board, &undo);
+	}
+
+	return notes;
+}
+
+/**
+ * Writes a move in standard algebraic notation, e.g. Nbxd7+.
+ *
+ * @param destStr  Where the SAN is written to. It has to fit PLY_SAN_LENGTH chars
+ * @param board    The game instance being played, before the move is played
+ * @param move     A legal move for the side whose turn it is
+ */
+void san_write(char *destStr, Game *board, PackedMove move)
+{
+	Ply ply;
+
+	ply.move = move;
+	ply.notes = san_notes(board, move);
+	ply_to_PGN(destStr, ply);
+}
+
+/**
+ * Reads a move in standard algebraic notation and finds it in the position.
+ *
+ * @param board  The game instance being played
+ * @param str    The SAN, e.g. Nf3
+ *
+ * @return the move, or PM_NONE if str isn't one of the legal moves
+ */
+PackedMove san_to_move(Game *board, const char *str)
+{
+	SanMove san;
+	Slice slice;
+
+	slice.str = str;
+	slice.length = string_getlen(str);
+
+	return san_parse(slice, &san) ? san_resolve(board, &san) : PM_NONE;
+}
+
+/**
+ * Times how fast moves in SAN are taken apart, and how fast they're found in the position
+ * as well, by going through the same game SAN_BENCHMARK_ROUNDS times.
+ */
+void san_benchmark()
+{
+	/* The opera game, Morphy against the Duke of Brunswick and Count Isouard, 1858 */
+	const char *GAME[] =
+	{
+		"e4", "e5", "Nf3", "d6", "d4", "Bg4", "dxe5", "Bxf3", "Qxf3", "dxe5",
+		"Bc4", "Nf6", "Qb3", "Qe7", "Nc3", "c6", "Bg5", "b5", "Nxb5", "cxb5",
+		"Bxb5+", "Nbd7", "O-O-O", "Rd8", "Rxd7", "Rxd7", "Rd1", "Qe6", "Bxd7+", "Nxd7",
+		"Qb8+", "Nxb8", "Rd8#"
+	};
+	const uint_fast8_t plies = sizeof(GAME) / sizeof(GAME[0]);
+
+	Game *board = init_game();
+	Slice slices[sizeof(GAME) / sizeof(GAME[0])];
+	SanMove san;
+	uintmax_t round, parsed = 0;
+	uint_fast8_t i;
+	clock_t start;
+	double seconds;
+
+	for(i = 0; i < plies; i++)
+	{
+		slices[i].str = GAME[i];
+		slices[i].length = string_getlen(GAME[i]);
+	}
+
+	start = clock();
+	for(round = 0; round < SAN_BENCHMARK_ROUNDS; round++)
+		for(i = 0; i < plies; i++)
+			parsed += san_parse(slices[i], &san);
+	seconds = ((double) (clock() - start)) / CLOCKS_PER_SEC;
+
+	printf("parsed:   %" PRIuMAX " moves in %.3lfs", parsed, seconds);
+	if(seconds > 0) printf(" (%.0lf moves/s)", parsed / seconds);
+	printf("\n");
+
+	parsed = 0;
+	start = clock();
+	for(round = 0; round < SAN_BENCHMARK_ROUNDS / 10; round++)
+	{
+		game_reset(board);
+
+		for(i = 0; i < plies; i++)
+		{
+			PackedMove move;
+			bool SAN_NOT_FOUND;
+
+			san_parse(slices[i], &san);
+			move = san_resolve(board, &san);
+
+			SAN_NOT_FOUND = move != PM_NONE;
+			assert(SAN_NOT_FOUND);
+
+			push_move(board, move);
+			parsed++;
+		}
+	}
+	seconds = ((double) (clock() - start)) / CLOCKS_PER_SEC;
+
+	printf("resolved: %" PRIuMAX " moves in %.3lfs", parsed, seconds);
+	if(seconds > 0) printf(" (%.0lf moves/s, making them included)", parsed / seconds);
+	printf("\n");
+
+	free_game(board);
+}
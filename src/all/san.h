@@ -0,0 +1,26 @@
+#ifndef SAN_H_INCLUDED
+#define SAN_H_INCLUDED
+
+#include "chess.h"
+
+/* A move in standard algebraic notation, taken apart but not yet matched to a piece */
+typedef struct
+{
+	uint_least8_t type;         /* the PIECE_ type that moves */
+	uint_least8_t fromFile;     /* 0 to 7 for a to h, or SAN_ANY */
+	uint_least8_t fromRank;     /* 0 to 7 for 1 to 8, or SAN_ANY */
+	uint_least8_t to;           /* the square it lands on by location_getindex() */
+	uint_least8_t promotion;    /* what a pawn becomes, PIECE_PAWN if the SAN doesn't say */
+	uint_least8_t flags;        /* the SAN_ flags */
+} SanMove;
+
+bool san_parse(Slice, SanMove*);
+PackedMove san_resolve(Game*, const SanMove*);
+PackedMove san_to_move(Game*, const char*);
+
+uint_fast8_t san_notes(Game*, PackedMove);
+void san_write(char*, Game*, PackedMove);
+
+void san_benchmark();
+
+#endif /* SAN_H_INCLUDED */
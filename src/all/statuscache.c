@@ -0,0 +1,100 @@
+#include "statuscache.h"
+
+/*
+ * Remembers whether positions are check, checkmate or stalemate so that working it out
+ * again for a position that comes up again (a transposition, a takeback, the same opening
+ * in another game) is a single lookup. Positions are found by their Zobrist key.
+ *
+ * The cache is direct-mapped: a key can only go in one entry, picked by its low bits, and a
+ * new position always replaces whatever was in its entry. That keeps the cache to a fixed
+ * size and keeps both probing and storing to one memory access.
+ */
+
+/**
+ * Makes an empty cache.
+ *
+ * @param size  How many positions it can hold. Rounded down to a power of two
+ *
+ * @return the cache, to be freed with status_cache_free()
+ */
+StatusCache *status_cache_init(uintmax_t size)
+{
+	StatusCache *ret = malloc(sizeof(StatusCache));
+	uintmax_t entries = 1;
+
+	assert(size > 0);
+
+	while(entries * 2 <= size)
+		entries *= 2;
+
+	ret->entries = malloc(entries * sizeof(StatusEntry));
+	ret->mask = entries - 1;
+
+	status_cache_clear(ret);
+
+	return ret;
+}
+
+void status_cache_free(StatusCache *cache)
+{
+	free(cache->entries);
+	free(cache);
+}
+
+/**
+ * Forgets every position and resets the hit and miss counters.
+ *
+ * @param cache  The cache being cleared
+ */
+void status_cache_clear(StatusCache *cache)
+{
+	uintmax_t i;
+
+	for(i = 0; i <= cache->mask; i++)
+		cache->entries[i].used = false;
+
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+/**
+ * Looks a position up.
+ *
+ * @param cache   The cache being searched
+ * @param key     The position's Zobrist key
+ * @param status  Gets the CHECK_ flags of the position if it's found
+ *
+ * @return true if the position was found
+ */
+bool status_cache_probe(StatusCache *cache, uint_least64_t key, uint_fast8_t *status)
+{
+	const StatusEntry *entry = &(cache->entries[key & cache->mask]);
+
+	if(entry->used && entry->key == key)
+	{
+		*status = entry->status;
+		cache->hits++;
+
+		return true;
+	}
+
+	cache->misses++;
+
+	return false;
+}
+
+/**
+ * Remembers a position, replacing whichever position was in its entry.
+ *
+ * @param cache   The cache being added to
+ * @param key     The position's Zobrist key
+ * @param status  The CHECK_ flags of the position
+ */
+void status_cache_store(StatusCache *cache, uint_least64_t key, uint_fast8_t status)
+{
+	StatusEntry *entry = &(cache->entries[key & cache->mask]);
+
+	entry->key = key;
+	entry->status = status;
+	entry->used = true;
+}
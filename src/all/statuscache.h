@@ -0,0 +1,27 @@
+#ifndef STATUSCACHE_H_INCLUDED
+#define STATUSCACHE_H_INCLUDED
+
+#include "chess.h"
+
+typedef struct
+{
+	uint_least64_t key;
+	uint_least8_t status;
+	bool used;
+} StatusEntry;
+
+struct status_cache
+{
+	StatusEntry *entries;
+	uintmax_t mask;			/* the number of entries minus one */
+	uintmax_t hits;
+	uintmax_t misses;
+};
+
+StatusCache *status_cache_init(uintmax_t);
+void status_cache_free(StatusCache*);
+void status_cache_clear(StatusCache*);
+bool status_cache_probe(StatusCache*, uint_least64_t, uint_fast8_t*);
+void status_cache_store(StatusCache*, uint_least64_t, uint_fast8_t);
+
+#endif /* STATUSCACHE_H_INCLUDED */
@@ -1,19 +1,17 @@
 #include "tests.h"
+#include "attacks.h"
+#include "batch.h"
 #include "commands.h"
-
-void test_valid_macros()
-{
-	uint_fast8_t i, j;
-	uint_fast8_t is_validMacros[5] = {VALID_BROADCASTCALL, VALID_IGNORECOLOR, VALID_KINGNOLIMIT, VALID_PAWNATKONLY, VALID_SELFCHECK};
-	
-	for(i = 0; i < 5; i++)
-	{
-		for(j = i + 1; j < 5; j++)
-		{
-			assert(!(is_validMacros[i] & is_validMacros[j]));
-		}
-	}
-}
+#include "fen.h"
+#include "filereading.h"
+#include "makemove.h"
+#include "movegen.h"
+#include "perft.h"
+#include "pgnindex.h"
+#include "replay.h"
+#include "san.h"
+#include "statuscache.h"
+#include "zobrist.h"
 
 void test_PGN_macros()
 {
@@ -71,7 +69,6 @@ void test_macros()
 
 	test_on_board_macro();
 	test_piece_macros();
-	test_valid_macros();
 }
 
 
@@ -81,8 +78,8 @@ void test_piece_placement()
 {
 	Game *board = init_game();
 
-	Piece **WhitePieces = board->White;
-	Piece **BlackPieces = board->Black;
+	Piece *WhitePieces = board->White;
+	Piece *BlackPieces = board->Black;
 
 	uint_fast8_t i;
 	Piece *curW, *curB;
@@ -135,15 +132,12 @@ void test_piece_placement()
 
 		assert(pieceMap[i] != 6);
 
-		curW = WhitePieces[i];
-		curB = BlackPieces[i];
+		curW = &(WhitePieces[i]);
+		curB = &(BlackPieces[i]);
 
 		assert(curW->type == pieceMap[i]);
 		assert(curB->type == pieceMap[i]);
 
-		assert(curW->hasMoved == false);
-		assert(curW->hasMoved == false);
-
 		x = (i % 8) + 1;
 		y = 2 - (i / 8);
 
@@ -157,38 +151,55 @@ void test_piece_placement()
 	free_game(board);
 }
 
+/* Whether p can legally move to loc, whether or not it's p's turn */
+static bool can_move_to(Game *board, const Piece *p, Location loc)
+{
+	const uint_fast8_t from = location_getindex(p->currentLocation);
+	const uint_fast8_t to = location_getindex(loc);
+	MoveBuffer buffer;
+	uint_fast16_t i;
+
+	generate_legal_moves(board, p->color, &buffer);
+
+	for(i = 0; i < buffer.count; i++)
+		if(PM_FROM(buffer.moves[i]) == from && PM_TO(buffer.moves[i]) == to)
+			return true;
+
+	return false;
+}
+
 void test_castling()
 {
 	uint_fast8_t i;
 	Location kingside, queenside;
 	Game *board = init_game();
 
-	Piece **WhitePieces = board->White;
-	Piece **BlackPieces = board->Black;
+	Piece *WhitePieces = board->White;
+	Piece *BlackPieces = board->Black;
 
 
 	/* Remove every piece between the kings and the rooks. */
 	for(i = I_KNIGHT1; i < I_ROOK2; i++)
 	{
-		if(WhitePieces[i]->type != PIECE_KING)
+		if(WhitePieces[i].type != PIECE_KING)
 		{
-			capture(board, WhitePieces[i]);
-			capture(board, BlackPieces[i]);
+			capture(board, &(WhitePieces[i]));
+			capture(board, &(BlackPieces[i]));
 		}
 	}
 
 	location_assign(&kingside, 7, 1);
-	assert(is_valid_move(board, WhitePieces[I_KING], kingside, 0));
+	assert(can_move_to(board, &(WhitePieces[I_KING]), kingside));
 
 	location_assign(&queenside, 3, 1);
-	assert(is_valid_move(board, WhitePieces[I_KING], queenside, 0));
+	assert(can_move_to(board, &(WhitePieces[I_KING]), queenside));
 
 
 	location_setrank(&kingside, 8);
-	assert(is_valid_move(board, BlackPieces[I_KING], kingside, 0));
+	assert(can_move_to(board, &(BlackPieces[I_KING]), kingside));
 
 	location_assign(&queenside, 3, 8);
-	assert(is_valid_move(board, BlackPieces[I_KING], queenside, 0));
+	assert(can_move_to(board, &(BlackPieces[I_KING]), queenside));
 
 	free_game(board);
 }
@@ -196,12 +207,42 @@ void test_castling()
 
 
 
+void test_castling_rights()
+{
+	const uint_fast8_t all = CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE | CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE;
+	Game *board = init_game();
+
+	assert(board->castling == all);
+
+	/* A rook leaving its corner loses one right, even once it's back */
+	assert(process_move(board, "Nf3", 0));
+	assert(process_move(board, "Nf6", 0));
+	assert(process_move(board, "Rg1", 0));
+	assert(board->castling == (all & ~CASTLE_WHITE_KINGSIDE));
+	assert(process_move(board, "Rg8", 0));
+	assert(process_move(board, "Rh1", 0));
+	assert(board->castling == (CASTLE_WHITE_QUEENSIDE | CASTLE_BLACK_QUEENSIDE));
+	assert(board->hash == zobrist_compute(board));
+
+	command(board, "takeback");
+	assert(board->castling == (all & ~CASTLE_WHITE_KINGSIDE & ~CASTLE_BLACK_KINGSIDE));
+
+	/* Taking a rook on its corner loses the right too */
+	assert(load_fen(board, "r3k2r/8/8/8/8/8/8/R3K2R w Kq - 0 1") == TEAM_WHITE);
+	assert(board->castling == (CASTLE_WHITE_KINGSIDE | CASTLE_BLACK_QUEENSIDE));
+	assert(process_move(board, "Rxa8", 0));
+	assert(board->castling == CASTLE_WHITE_KINGSIDE);
+	assert(board->hash == zobrist_compute(board));
+
+	free_game(board);
+}
+
 void test_pawn_forward()
 {
 	Game *board = init_game();
 
-	Piece **WhitePieces = board->White;
-	Piece **BlackPieces = board->Black;
+	Piece *WhitePieces = board->White;
+	Piece *BlackPieces = board->Black;
 
 	Location temp;
 	uint_fast8_t i;
@@ -209,22 +250,22 @@ void test_pawn_forward()
 	{
 		Piece *w, *b;
 
-		w = WhitePieces[i];
+		w = &(WhitePieces[i]);
 
 		location_assign(&temp, location_getfile(w->currentLocation), 3);
-		assert(is_valid_move(board, w, temp, 0));
+		assert(can_move_to(board, w, temp));
 
 		location_setrank(&temp, location_getrank(temp) + 1);
-		assert(is_valid_move(board, w, temp, 0));
+		assert(can_move_to(board, w, temp));
 
 
-		b = BlackPieces[i];
+		b = &(BlackPieces[i]);
 
 		location_setrank(&temp, 6);
-		assert(is_valid_move(board, b, temp, 0));
+		assert(can_move_to(board, b, temp));
 
 		location_setrank(&temp, location_getrank(temp) - 1);
-		assert(is_valid_move(board, b, temp, 0));
+		assert(can_move_to(board, b, temp));
 	}
 
 	free_game(board);
@@ -233,65 +274,470 @@ void test_pawn_forward()
 void test_pawn_capture()
 {
 	Piece *w, *b;
+	Location loc;
 	Game *board = init_game();
 
-	w = board->White[I_PAWN5];
-	location_setrank(&(w->currentLocation), 4);
+	w = &(board->White[I_PAWN5]);
+	location_assign(&loc, location_getfile(w->currentLocation), 4);
+	relocate(board, w, loc);
 
-	b = board->Black[I_PAWN4];
-	location_setrank(&(b->currentLocation), 5);
+	b = &(board->Black[I_PAWN4]);
+	location_assign(&loc, location_getfile(b->currentLocation), 5);
+	relocate(board, b, loc);
 
-	assert(is_valid_move(board, w, b->currentLocation, 0));
-	assert(is_valid_move(board, b, w->currentLocation, 0));
+	assert(can_move_to(board, w, b->currentLocation));
+	assert(can_move_to(board, b, w->currentLocation));
 	
 	free_game(board);
 }
 
-void test_decipher()
+void test_en_passant()
 {
+	Piece *w;
+	Location loc;
 	Game *board = init_game();
 
-	Move a;
+	/* The pawn that can be taken comes from the position, there's no history to look at */
+	assert(load_fen(board, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1") == TEAM_WHITE);
+	w = piece_at(board, 0x55);
+	assert(w != NULL && w->type == PIECE_PAWN);
+	location_assign(&loc, 4, 6);
+	assert(can_move_to(board, w, loc));
+	assert(process_move(board, "exd6", 0));
+	assert(board->occupied[TEAM_BLACK] == BB_SQUARE(60));
+	assert(board->enPassant == 0);
+
+	/* and the chance is gone after one move */
+	assert(load_fen(board, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1") == TEAM_WHITE);
+	assert(process_move(board, "Kd1", 0));
+	assert(process_move(board, "Kd8", 0));
+	assert(!can_move_to(board, w, loc));
+	assert(!process_move(board, "exd6", 0));
+
+	/* Placing a piece makes a new position, which doesn't have the square any more */
+	assert(load_fen(board, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1") == TEAM_WHITE);
+	command(board, "place 16 a6");
+	assert(board->enPassant == 0 && board->hash == zobrist_compute(board));
+	assert(!process_move(board, "exd6", 0));
+
+	free_game(board);
+}
 
-	Piece **WhitePieces = board->White;
-	Piece **BlackPieces = board->Black;
+/* Takes str apart with san_parse() */
+static bool parse(const char *str, SanMove *san)
+{
+	Slice slice;
 
-	/* test normal pawn movements */
-	a = decipher_move(board, TEAM_WHITE, "e4", 0);
-	assert(a.p == WhitePieces[I_PAWN5]);
-	assert(location_getfile(a.loc) == 5);
-	assert(location_getrank(a.loc) == 4);
+	slice.str = str;
+	slice.length = string_getlen(str);
 
+	return san_parse(slice, san);
+}
 
+void test_san_parse()
+{
+	const char *INVALID[] = {"", "N", "Zf3", "e9", "i4", "Nf", "e4 ", "Kd8=Q", "e8=K", "e8=", "O", "O-O-O-O", "O-", "1-0", "*", "Nb1c3d4", "e4e"};
+	SanMove san;
+	uint_fast8_t i;
 
-	a = decipher_move(board, TEAM_BLACK, "b6", 0);
-	assert(a.p == BlackPieces[I_PAWN2]);
-	assert(location_equals_coords(a.loc, 2, 6));
+	assert(parse("e4", &san));
+	assert(san.type == PIECE_PAWN && san.fromFile == SAN_ANY && san.fromRank == SAN_ANY);
+	assert(san.to == 28 && san.promotion == PIECE_PAWN && san.flags == 0);
 
+	assert(parse("Nbxd7+", &san));
+	assert(san.type == PIECE_KNIGHT && san.fromFile == 1 && san.fromRank == SAN_ANY);
+	assert(san.to == 51 && san.flags == (SAN_CAPTURE | SAN_CHECK));
 
+	assert(parse("R1e2", &san));
+	assert(san.type == PIECE_ROOK && san.fromFile == SAN_ANY && san.fromRank == 0 && san.to == 12);
 
-	/* test castling */
-	a = decipher_move(board, TEAM_WHITE, "O-O", 0);
-	assert(a.p == WhitePieces[I_KING]);
-	assert(location_equals_coords(a.loc, 7, 1));
+	assert(parse("Qh4xe1#", &san));
+	assert(san.type == PIECE_QUEEN && san.fromFile == 7 && san.fromRank == 3);
+	assert(san.to == 4 && san.flags == (SAN_CAPTURE | SAN_MATE));
 
+	/* Promotions, with and without the = */
+	assert(parse("exd8=Q#", &san));
+	assert(san.type == PIECE_PAWN && san.fromFile == 4 && san.to == 59);
+	assert(san.promotion == PIECE_QUEEN && san.flags == (SAN_CAPTURE | SAN_MATE));
 
+	assert(parse("a1N", &san));
+	assert(san.to == 0 && san.promotion == PIECE_KNIGHT);
 
-	a = decipher_move(board, TEAM_BLACK, "O-O-O", 0);
-	assert(a.p == BlackPieces[I_KING]);
-	assert(location_equals_coords(a.loc, 3, 8));
+	/* Long algebraic notation */
+	assert(parse("e2-e4", &san));
+	assert(san.fromFile == 4 && san.fromRank == 1 && san.to == 28);
 
+	/* Castling, with letters or zeros */
+	assert(parse("O-O", &san) && san.flags == SAN_CASTLE_KINGSIDE);
+	assert(parse("0-0-0+", &san) && san.flags == (SAN_CASTLE_QUEENSIDE | SAN_CHECK));
 
+	/* Annotations don't change the move */
+	assert(parse("Nf3!?", &san) && san.type == PIECE_KNIGHT && san.to == 21 && san.flags == 0);
+	assert(parse("e4??", &san) && san.to == 28);
 
-	/* test back row moves */
-	a = decipher_move(board, TEAM_WHITE, "Qxb5", 0);
-	assert(a.p == WhitePieces[I_QUEEN]);
-	assert(location_equals_coords(a.loc, 2, 5));
+	for(i = 0; i < sizeof(INVALID) / sizeof(INVALID[0]); i++)
+		assert(!parse(INVALID[i], &san));
+}
 
+void test_san_resolve()
+{
+	Game *board = init_game();
+	PackedMove move;
+	char str[PLY_SAN_LENGTH];
+
+	/* From the start */
+	assert(san_to_move(board, "e4") == PM_PACK(12, 28, PM_DOUBLEPUSH));
+	assert(san_to_move(board, "e3") == PM_PACK(12, 20, PM_QUIET));
+	assert(san_to_move(board, "Nf3") == PM_PACK(6, 21, PM_QUIET));
+	assert(san_to_move(board, "Nxf3") == PM_NONE);
+	assert(san_to_move(board, "exd3") == PM_NONE);
+	assert(san_to_move(board, "e5") == PM_NONE);
+	assert(san_to_move(board, "Qxb5") == PM_NONE);
+	assert(san_to_move(board, "O-O") == PM_NONE);
+	assert(san_to_move(board, "Ke2") == PM_NONE);
+
+	/* En passant is a capture even though the square it lands on is empty */
+	assert(load_fen(board, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1") == TEAM_WHITE);
+	assert(san_to_move(board, "exd6") == PM_PACK(36, 43, PM_ENPASSANT));
+	assert(san_to_move(board, "Kxd2") == PM_NONE);
+
+	assert(load_fen(board, "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1") == TEAM_WHITE);
+	assert(san_to_move(board, "O-O") == PM_PACK(4, 6, PM_CASTLE_KINGSIDE));
+	assert(san_to_move(board, "0-0-0") == PM_PACK(4, 2, PM_CASTLE_QUEENSIDE));
+
+	/* A pawn that doesn't say what it becomes becomes a queen */
+	assert(load_fen(board, "r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1") == TEAM_WHITE);
+	assert(san_to_move(board, "b8") == PM_PACK(49, 57, PM_PROMOTION_QUEEN));
+	assert(san_to_move(board, "b8=N") == PM_PACK(49, 57, PM_PROMOTION_KNIGHT));
+	assert(san_to_move(board, "bxa8=R+") == PM_PACK(49, 56, PM_PROMOTION_ROOK | PM_CAPTURE));
+
+	/* Annotations can make a move longer than its SAN ever is */
+	assert(process_move(board, "b7xa8=Q+!?", 0));
+	assert(get_latest_move(board->Moves)->move == PM_PACK(49, 56, PM_PROMOTION_QUEEN | PM_CAPTURE));
+	assert(load_fen(board, "r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1") == TEAM_WHITE);
+	assert(san_to_move(board, "Kd2=Q") == PM_NONE);
+
+	/* Three queens that can all reach h8 */
+	assert(load_fen(board, "Q7/8/8/6K1/8/8/3k4/Q6Q w - - 0 1") == TEAM_WHITE);
+	assert(san_to_move(board, "Qh8") == PM_NONE);
+	assert(san_to_move(board, "Qah8") == PM_NONE);
+	assert(san_to_move(board, "Q1h8") == PM_NONE);
+	assert(san_to_move(board, "Qa1h8") == PM_PACK(0, 63, PM_QUIET));
+	assert(san_to_move(board, "Q8h8") == PM_PACK(56, 63, PM_QUIET));
+	assert(san_to_move(board, "Qhh8") == PM_PACK(7, 63, PM_QUIET));
+
+	/* and the notation tells each of them apart with as little as it can */
+	move = PM_PACK(0, 63, PM_QUIET);
+	san_write(str, board, move);
+	assert(string_matches(str, "Qa1h8"));
+
+	move = PM_PACK(56, 63, PM_QUIET);
+	san_write(str, board, move);
+	assert(string_matches(str, "Q8h8"));
+
+	move = PM_PACK(7, 63, PM_QUIET);
+	san_write(str, board, move);
+	assert(string_matches(str, "Qhh8"));
+
+	/* A pinned knight can't go to e4, so the other one doesn't need telling apart */
+	assert(load_fen(board, "4k3/8/8/4b3/8/2N3N1/8/K7 w - - 0 1") == TEAM_WHITE);
+	assert(san_to_move(board, "Ne4") == PM_PACK(22, 28, PM_QUIET));
+	assert(san_to_move(board, "Nce4") == PM_NONE);
+
+	move = PM_PACK(22, 28, PM_QUIET);
+	san_write(str, board, move);
+	assert(string_matches(str, "Ne4"));
+
+	/* Check and mate, found without playing the move unless it checks */
+	game_reset(board);
+	assert(process_move(board, "f3", 0) && process_move(board, "e5", 0) && process_move(board, "g4", 0));
+	san_write(str, board, san_to_move(board, "Qh4"));
+	assert(string_matches(str, "Qh4#"));
+	san_write(str, board, san_to_move(board, "Bb4"));
+	assert(string_matches(str, "Bb4"));
+
+	assert(load_fen(board, "5k2/8/8/8/8/8/8/4K2R w K - 0 1") == TEAM_WHITE);
+	san_write(str, board, PM_PACK(4, 6, PM_CASTLE_KINGSIDE));
+	assert(string_matches(str, "O-O+"));
+
+	assert(load_fen(board, "1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1") == TEAM_WHITE);
+	san_write(str, board, PM_PACK(48, 57, PM_PROMOTION_QUEEN | PM_CAPTURE));
+	assert(string_matches(str, "axb8=Q+"));
+	san_write(str, board, PM_PACK(48, 57, PM_PROMOTION_KNIGHT | PM_CAPTURE));
+	assert(string_matches(str, "axb8=N"));
 
 	free_game(board);
 }
 
+/* Reads the file test_pgn_reader() writes, either mapped or through a buffer */
+static void check_pgn_reader(FILE *fp, bool map)
+{
+	const char *CYCLE[4] = {"Nf3", "Nf6", "Ng1", "Ng8"};
+	PGNReader reader;
+	Slice token;
+	char str[20];
+	uintmax_t i;
+	long length;
+
+	fseek(fp, 0, SEEK_END);
+	length = ftell(fp);
+	rewind(fp);
+	pgn_from_stream(&reader, fp, map);
+#ifdef PGN_CAN_MAP
+	assert(reader.mapped == map);
+#endif
+
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 2 && string_matches(str, "e4"));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 2 && string_matches(str, "e5"));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 3 && string_matches(str, "Nf3"));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 3 && string_matches(str, "Nc6"));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 4 && string_matches(str, "Bb5+"));
+	assert(pgn_offset(&reader, token.str) == 88);
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 2 && string_matches(str, "a6"));
+
+	for(i = 0; i < PGN_BUFFER_SIZE / 2; i++)
+	{
+		assert(pgn_next_token(&reader, &token));
+		slice_copy(str, 20, token);
+		assert(string_matches(str, CYCLE[i % 4]));
+	}
+
+	assert(pgn_next_token(&reader, &token));
+	slice_copy(str, 20, token);
+	assert(string_matches_end(str) && string_matches(str, "1/2-1/2"));
+	assert(pgn_offset(&reader, token.str) + 8 == (uintmax_t) length);
+	assert(!pgn_next_token(&reader, &token));
+	assert(reader.bytes > PGN_BUFFER_SIZE);
+
+	pgn_close(&reader);
+}
+
+void test_pgn_reader()
+{
+	const char *CYCLE[4] = {"Nf3", "Nf6", "Ng1", "Ng8"};
+	Slice token;
+	char str[20];
+	uintmax_t i;
+	FILE *fp = tmpfile();
+
+	assert(fp != NULL);
+
+	fputs("[Event \"Test\"]\n[White \"1. e4\"]\n\n", fp);
+	fputs("1.e4 e5 {2. d4} 2. Nf3 ; Nc3 is just as good\n2... Nc6\t3.Bb5+\r\n", fp);
+	fputs("$1 (3. Bc4 (3. d4 $5 exd4) Bc5 {not over)} 4. c3) 3... a6$6\n", fp);
+
+	/* Long enough that moves cross from one buffer full to the next */
+	for(i = 0; i < PGN_BUFFER_SIZE / 4; i++)
+		fprintf(fp, "%" PRIuMAX ". %s %s ", i + 4, CYCLE[(2 * i) % 4], CYCLE[(2 * i + 1) % 4]);
+	fputs("1/2-1/2\n", fp);
+
+	check_pgn_reader(fp, true);
+	check_pgn_reader(fp, false);
+
+	fclose(fp);
+
+	/* slice_copy() cuts a slice short to fit */
+	token.str = "abcdef";
+	token.length = 6;
+	assert(slice_copy(str, 4, token) == 3 && string_matches(str, "abc"));
+}
+
+/* Puts the path of a file called name in the temp directory into path, which has room for size chars */
+static void temp_path(char *path, uintmax_t size, const char *name)
+{
+	const char *dir = getenv("TMPDIR");
+
+	if(dir == NULL) dir = getenv("TEMP");
+	if(dir == NULL) dir = "/tmp";
+
+	assert(string_getlen(dir) + string_getlen(name) + 2 <= size);
+	string_copy(path, dir);
+	string_concatenate(path, "/");
+	string_concatenate(path, name);
+}
+
+/* Writes the games test_pgn_index() indexes. Returns how long the file is */
+static long write_pgn_index_file(const char *filename, bool extra)
+{
+	long length;
+	FILE *fp = fopen(filename, "w");
+
+	assert(fp != NULL);
+
+	fputs("[Event \"One\"]\n[White \"Morphy, Paul\"]\n[Black \"Duke \\\"Karl\\\"\"]\n\n1. e4 e5 2. Qh5 Ke7 3. Qxe5# 1-0\n\n", fp);
+	fputs("[Event \"Two\"]\n\n1. d4 {a [comment]} d5 1/2-1/2\n\n", fp);
+	fputs("1. c4 *\n\n", fp);
+	fputs("[Event \"Four\"]\n1. Nf3 Nf6", fp);
+	if(extra) fputs(" 0-1\n[Event \"Five\"]\n1. g3 *\n", fp);
+
+	length = ftell(fp);
+	fclose(fp);
+
+	return length;
+}
+
+void test_pgn_index()
+{
+	PGNIndex index;
+	PGNGame game;
+	PGNReader reader;
+	Slice token;
+	char str[20], PGN[256], INDEX[256], name[160];
+	long length;
+	uintmax_t i;
+	FILE *fp;
+
+	temp_path(PGN, 256, "test_pgn_index.pgn");
+	temp_path(INDEX, 256, "test_pgn_index.pgn.idx");
+
+	remove(INDEX);
+	length = write_pgn_index_file(PGN, false);
+
+	assert(pgn_index_open(&index, PGN));
+	assert(index.count == 4);
+
+	assert(pgn_index_game(&index, 1, &game));
+	assert(game.offset == 0 && game.length == 94);
+	assert(string_matches(pgn_tag(&game, "Event"), "One"));
+	assert(string_matches(pgn_tag(&game, "White"), "Morphy, Paul"));
+	assert(string_matches(pgn_tag(&game, "Black"), "Duke \\\"Karl\\\""));
+	assert(pgn_tag(&game, "Result") == NULL);
+
+	/* Straight to the third game, which has no tag pairs and so starts at its first move */
+	assert(pgn_index_game(&index, 3, &game));
+	assert(game.offset == 146 && game.length == 4 && game.tags[0] == '\0');
+
+	/* The last game has no result, so it runs to the end of the file */
+	assert(pgn_index_game(&index, 4, &game));
+	assert(game.offset + game.length == (uintmax_t) length);
+	assert(string_matches(pgn_tag(&game, "Event"), "Four"));
+
+	assert(!pgn_index_game(&index, 0, &game));
+	assert(!pgn_index_game(&index, 5, &game));
+
+	/* Only the moves of the game that was asked for are read */
+	assert(pgn_index_game(&index, 2, &game));
+	assert(pgn_open_range(&reader, PGN, game.offset, game.length));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 2 && string_matches(str, "d4"));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 2 && string_matches(str, "d5"));
+	assert(pgn_next_token(&reader, &token) && slice_copy(str, 20, token) == 7 && string_matches(str, "1/2-1/2"));
+	assert(!pgn_next_token(&reader, &token));
+	pgn_close(&reader);
+
+	pgn_index_close(&index);
+
+	/* The index was kept, and is used again the next time */
+	fp = fopen(INDEX, "rb");
+	assert(fp != NULL);
+	fclose(fp);
+	assert(pgn_index_open(&index, PGN) && index.count == 4);
+	pgn_index_close(&index);
+
+	/* It's made again once the file changes */
+	write_pgn_index_file(PGN, true);
+	assert(pgn_index_open(&index, PGN) && index.count == 5);
+	assert(pgn_index_game(&index, 4, &game) && game.length == 29);
+	assert(pgn_index_game(&index, 5, &game) && string_matches(pgn_tag(&game, "Event"), "Five"));
+	pgn_index_close(&index);
+
+	remove(PGN);
+	remove(INDEX);
+
+	/* A path too long for a signed char to count still gets its index next to the file */
+	for(i = 0; i < 150; i++)
+		name[i] = 'x';
+	string_copy(name + 150, ".pgn");
+	temp_path(PGN, 256, name);
+	string_concatenate(name, ".idx");
+	temp_path(INDEX, 256, name);
+
+	write_pgn_index_file(PGN, false);
+	remove(INDEX);
+	assert(pgn_index_open(&index, PGN) && !index.temporary && index.count == 4);
+	pgn_index_close(&index);
+
+	fp = fopen(INDEX, "rb");
+	assert(fp != NULL);
+	fclose(fp);
+
+	remove(PGN);
+	remove(INDEX);
+}
+
+void test_move_list()
+{
+	MoveList ML;
+	Turn t;
+	Ply ply;
+	uintmax_t i;
+	char san[PLY_SAN_LENGTH];
+
+	init_move_list(&ML);
+	assert(get_latest_move(ML) == NULL);
+	t = get_move_number(ML, 1);
+	assert(t.White[0] == '\0');
+
+	/* Long enough to make the array grow a few times. Move i goes from a1 to the square numbered i % 64 */
+	ply.notes = TYPE_INDEX(PIECE_QUEEN);
+	for(i = 0; i < 501; i++)
+	{
+		ply.move = PM_PACK(0, i % 64, PM_QUIET);
+		add_move(&ML, ply);
+	}
+
+	assert(get_turn_count(ML) == 251);
+	t = get_move_number(ML, 100);
+	assert(string_matches(t.White, "Qg1") && string_matches(t.Black, "Qh1"));	/* plies 198 and 199 */
+	t = get_move_number(ML, 251);
+	assert(string_matches(t.White, "Qe7") && t.Black[0] == '\0');
+	t = get_move_number(ML, 252);
+	assert(t.White[0] == '\0');
+
+	/* The result is shown in the slot after the last move */
+	set_result(&ML, "1/2-1/2");
+	t = get_move_number(ML, 251);
+	assert(string_matches(t.Black, "1/2-1/2"));
+	set_result(&ML, "");
+
+	remove_latest_move(&ML);
+	assert(get_turn_count(ML) == 250);
+	assert(PM_TO(get_latest_move(ML)->move) == 499 % 64);
+
+	/* Writing out plies */
+	ply.move = PM_PACK(4, 6, PM_CASTLE_KINGSIDE);
+	ply.notes = TYPE_INDEX(PIECE_KING) | PLY_CHECK;
+	ply_to_PGN(san, ply);
+	assert(string_matches(san, "O-O+"));
+
+	ply.move = PM_PACK(60, 58, PM_CASTLE_QUEENSIDE);
+	ply.notes = TYPE_INDEX(PIECE_KING);
+	ply_to_PGN(san, ply);
+	assert(string_matches(san, "O-O-O"));
+
+	ply.move = PM_PACK(52, 59, PM_CAPTURE | PM_PROMOTION_QUEEN);	/* e7xd8 */
+	ply.notes = TYPE_INDEX(PIECE_PAWN) | PLY_CHECK | PLY_MATE;
+	ply_to_PGN(san, ply);
+	assert(string_matches(san, "exd8=Q#"));
+
+	ply.move = PM_PACK(12, 28, PM_DOUBLEPUSH);
+	ply.notes = TYPE_INDEX(PIECE_PAWN);
+	ply_to_PGN(san, ply);
+	assert(string_matches(san, "e4"));
+
+	ply.move = PM_PACK(1, 11, PM_QUIET);
+	ply.notes = TYPE_INDEX(PIECE_KNIGHT) | PLY_FILESPECIFIED;
+	ply_to_PGN(san, ply);
+	assert(string_matches(san, "Nbd2"));
+
+	ply.move = PM_PACK(0, 16, PM_CAPTURE);
+	ply.notes = TYPE_INDEX(PIECE_ROOK) | PLY_RANKSPECIFIED;
+	ply_to_PGN(san, ply);
+	assert(string_matches(san, "R1xa3"));
+
+	free_move_list(&ML);
+	assert(ML.count == 0);
+}
+
 void test_string_remove()
 {
 	char egg[17] = "dog";
@@ -340,26 +786,63 @@ void test_string_split()
 	char empty[3][7];
 	
 	const char *egg = "green eggs ham";
-	uintmax_t splits = string_split(&empty[0][0], 15, egg, ' ');
+	uintmax_t splits = string_split(&empty[0][0], 7, egg, ' ');
 	
 	assert(splits == 3);
 	assert(splits == string_count_occurences_of_char(egg, ' ') + 1);
 	assert(string_matches(empty[0], "green"));
 	assert(string_matches(empty[1], "eggs"));
 	assert(string_matches(empty[2], "ham"));
+
+	/* Tokens that don't fit are cut short rather than running into the next one */
+	assert(string_split(&empty[0][0], 7, "breakfast  ", ' ') == 3);
+	assert(string_matches(empty[0], "breakf") && empty[1][0] == '\0' && empty[2][0] == '\0');
 }
 
-void test_tokenize()
+void test_tokenizer()
 {
-	char a[8] = "bxc3#";
-	tokenize_move(a);
-	assert(a[0] == 'b' && a[1] == 'c' && a[2] == '3' && a[3] == '\0');
+	const char *egg = "green eggs,ham";
+	Tokenizer outer, inner;
+	Slice token, word;
+
+	/* Two walks over the same string don't get in each other's way */
+	tokenizer_init(&outer, egg, string_getlen(egg), ',');
+	assert(tokenizer_next(&outer, &token) && slice_matches(token, "green eggs"));
+
+	tokenizer_init(&inner, token.str, token.length, ' ');
+	assert(tokenizer_next(&inner, &word) && slice_matches(word, "green"));
+	assert(tokenizer_next(&outer, &token) && slice_matches(token, "ham"));
+	assert(tokenizer_next(&inner, &word) && slice_matches(word, "eggs"));
+	assert(!tokenizer_next(&inner, &word));
+	assert(!tokenizer_next(&outer, &token));
+
+	/* Splitters next to each other or at either end have empty tokens around them */
+	tokenizer_init(&outer, " a  b ", 6, ' ');
+	assert(tokenizer_next(&outer, &token) && token.length == 0);
+	assert(tokenizer_next(&outer, &token) && slice_matches(token, "a"));
+	assert(tokenizer_next(&outer, &token) && token.length == 0);
+	assert(tokenizer_next(&outer, &token) && slice_matches(token, "b"));
+	assert(tokenizer_next(&outer, &token) && token.length == 0);
+	assert(!tokenizer_next(&outer, &token));
+
+	/* Nothing at all is still one token */
+	tokenizer_init(&outer, "", 0, ' ');
+	assert(tokenizer_next(&outer, &token) && token.length == 0);
+	assert(!tokenizer_next(&outer, &token));
+
+	/* Only length chars are looked at, so the buffer doesn't have to end there */
+	tokenizer_init(&outer, "e4 e5 Nf3", 5, ' ');
+	assert(tokenizer_next(&outer, &token) && slice_matches(token, "e4"));
+	assert(tokenizer_next(&outer, &token) && slice_matches(token, "e5"));
+	assert(!tokenizer_next(&outer, &token));
+
+	assert(!slice_matches(token, "e") && !slice_matches(token, "e55"));
 }
 
 void test_move()
 {
 	Game *board = init_game();
-	Location f3;
+	Location f3, queen;
 	
 	location_assign(&f3, 6, 3);
 
@@ -372,20 +855,20 @@ void test_move()
 	assert(process_move(board, "Nc6", 0));
 
 	assert(piece_is_on(board, f3));
-	assert(!is_valid_move(board, board->White[5], f3, 0));
+	assert(!can_move_to(board, &(board->White[5]), f3));
 
 	assert(process_move(board, "Ba3", 0));
 	assert(process_move(board, "f5", 0));
 
-	location_setfile(&(board->White[I_QUEEN]->currentLocation), location_getfile(board->White[I_QUEEN]->currentLocation) + 1);
-	location_setrank(&(board->White[I_QUEEN]->currentLocation), location_getrank(board->White[I_QUEEN]->currentLocation) + 2);
+	location_assign(&queen, location_getfile(board->White[I_QUEEN].currentLocation) + 1, location_getrank(board->White[I_QUEEN].currentLocation) + 2);
+	relocate(board, &(board->White[I_QUEEN]), queen);
 
-	assert(board->Black[5]->type == PIECE_PAWN);
-	assert(!is_valid_move(board, board->Black[5], f3, 0));
+	assert(board->Black[5].type == PIECE_PAWN);
+	assert(!can_move_to(board, &(board->Black[5]), f3));
 
 	assert(process_move(board, "Qxe7", 0));
-	assert(board->White[I_QUEEN]->currentLocation != 0);
-	assert(board->Black[I_PAWN5]->currentLocation == 0);
+	assert(board->White[I_QUEEN].currentLocation != 0);
+	assert(board->Black[I_PAWN5].currentLocation == 0);
 	assert(process_move(board, "Qe7", 0));
 
 	assert(process_move(board, "Bxe7", 0));
@@ -491,33 +974,829 @@ void test_move()
 
 
 
+/**
+ * Rebuilds the bitboards and mailbox of a game from its pieces and compares
+ * them to the incrementally maintained ones.
+ */
+bool position_matches(Game *board)
+{
+	uint_fast8_t i;
+	Bitboard occupied[3], typeBoards[PIECE_TYPES];
+	bool ret;
+
+	for(i = 0; i < 3; i++)
+		occupied[i] = BB_EMPTY;
+	for(i = 0; i < PIECE_TYPES; i++)
+		typeBoards[i] = BB_EMPTY;
+
+	for(i = 0; i < 2 * PIECES_PER_SIDE; i++)
+	{
+		Piece *p = i < PIECES_PER_SIDE ? &(board->White[i]) : &(board->Black[i - PIECES_PER_SIDE]);
+
+		if(p->currentLocation != 0)
+		{
+			if(piece_on(board, location_getindex(p->currentLocation)) != p)
+				return false;
+
+			occupied[0] |= BB_LOCATION(p->currentLocation);
+			occupied[p->color] |= BB_LOCATION(p->currentLocation);
+			typeBoards[TYPE_INDEX(p->type)] |= BB_LOCATION(p->currentLocation);
+		}
+	}
+
+	ret = true;
+	for(i = 0; i < 3; i++)
+		ret = ret && occupied[i] == board->occupied[i];
+	for(i = 0; i < PIECE_TYPES; i++)
+		ret = ret && typeBoards[i] == board->typeBoards[i];
+	for(i = 0; i < 64; i++)
+		ret = ret && (board->mailbox[i] != NO_PIECE) == (bool)(occupied[0] & BB_SQUARE(i));
+
+	/* The attack maps have to match asking every square for its attackers */
+	for(i = 0; i < 64; i++)
+	{
+		ret = ret && (attackers_to(board, i, TEAM_WHITE, occupied[0]) != BB_EMPTY) == (bool)(board->attacked[TEAM_WHITE] & BB_SQUARE(i));
+		ret = ret && (attackers_to(board, i, TEAM_BLACK, occupied[0]) != BB_EMPTY) == (bool)(board->attacked[TEAM_BLACK] & BB_SQUARE(i));
+	}
+
+	return ret;
+}
+
+void test_bitboards()
+{
+	Game *board = init_game();
+
+	assert(board->occupied[TEAM_WHITE] == UINT64_C(0xffff));
+	assert(board->occupied[TEAM_BLACK] == UINT64_C(0xffff000000000000));
+	assert(board->typeBoards[TYPE_INDEX(PIECE_PAWN)] == UINT64_C(0x00ff00000000ff00));
+	assert(board->typeBoards[TYPE_INDEX(PIECE_KING)] == UINT64_C(0x1000000000000010));
+	assert(position_matches(board));
+
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "d5", 0));
+	assert(process_move(board, "exd5", 0));
+	assert(position_matches(board));
+	assert(board->occupied[TEAM_BLACK] == UINT64_C(0xfff7000000000000));
+
+	assert(process_move(board, "Nf6", 0));
+	assert(process_move(board, "Nf3", 0));
+	assert(process_move(board, "Nxd5", 0));
+	assert(process_move(board, "Be2", 0));
+	assert(process_move(board, "e6", 0));
+	assert(process_move(board, "O-O", 0));
+	assert(position_matches(board));
+	assert(board->typeBoards[TYPE_INDEX(PIECE_KING)] & BB_SQUARE(6));
+	assert(board->typeBoards[TYPE_INDEX(PIECE_ROOK)] & BB_SQUARE(5));
+
+	free_game(board);
+
+
+	/* A move leaving the king in check is rolled back */
+	board = init_game();
+
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "d5", 0));
+	assert(process_move(board, "Bb5", 0));
+	assert(!process_move(board, "a6", 0));
+	assert(position_matches(board));
+	assert(!process_move(board, "dxe4", 0));
+	assert(position_matches(board));
+	assert(board->occupied[TEAM_WHITE] & BB_SQUARE(28));
+
+	free_game(board);
+}
+
+void test_mailbox()
+{
+	Location loc;
+	Game *board = init_game();
+
+	location_assign(&loc, 5, 1);
+	assert(piece_at(board, loc) == &(board->White[I_KING]));
+	location_assign(&loc, 1, 8);
+	assert(piece_at(board, loc) == &(board->Black[I_ROOK1]));
+	location_assign(&loc, 4, 4);
+	assert(piece_at(board, loc) == NULL);
+	assert(piece_at(board, 0) == NULL);
+
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "d5", 0));
+	assert(process_move(board, "exd5", 0));
+	assert(piece_at(board, loc) == NULL);
+	location_assign(&loc, 4, 5);
+	assert(piece_at(board, loc) == &(board->White[I_PAWN5]));
+	assert(board->Black[I_PAWN4].currentLocation == 0);
+
+	command(board, "place 16 d5");
+	assert(piece_at(board, loc) == &(board->Black[I_PAWN1]));
+	assert(board->White[I_PAWN5].currentLocation == 0);
+	assert(position_matches(board));
+
+	free_game(board);
+}
+
+void test_attack_tables()
+{
+	uint_fast8_t i, j;
+	Location a, b;
+
+	location_assign(&a, 1, 1);
+	location_assign(&b, 2, 3);
+	assert(KNIGHT_ATTACKS[location_getindex(a)] == (BB_LOCATION(b) | BB_SQUARE(10)));
+	assert(KING_ATTACKS[location_getindex(a)] == (BB_SQUARE(1) | BB_SQUARE(8) | BB_SQUARE(9)));
+
+	location_assign(&a, 5, 2);
+	assert(PAWN_ATTACKS[TEAM_WHITE - 1][location_getindex(a)] == (BB_SQUARE(19) | BB_SQUARE(21)));
+	location_assign(&a, 1, 7);
+	assert(PAWN_ATTACKS[TEAM_BLACK - 1][location_getindex(a)] == BB_SQUARE(41));
+
+	/* Knight and king attacks are symmetric, and pawn attacks mirror each other */
+	for(i = 0; i < 64; i++)
+	{
+		for(j = 0; j < 64; j++)
+		{
+			assert(!(KNIGHT_ATTACKS[i] & BB_SQUARE(j)) == !(KNIGHT_ATTACKS[j] & BB_SQUARE(i)));
+			assert(!(KING_ATTACKS[i] & BB_SQUARE(j)) == !(KING_ATTACKS[j] & BB_SQUARE(i)));
+			assert(!(PAWN_ATTACKS[0][i] & BB_SQUARE(j)) == !(PAWN_ATTACKS[1][j] & BB_SQUARE(i)));
+		}
+	}
+}
+
+void test_attack_maps()
+{
+	Game *board = init_game();
+	Piece *king;
+	Location loc;
+
+	/* Everything on the first three ranks except the corners */
+	assert(board->attacked[TEAM_WHITE] == UINT64_C(0xffff7e));
+	assert(board->attacked[TEAM_BLACK] == UINT64_C(0x7effff0000000000));
+	assert(position_matches(board));
+
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "e5", 0));
+	assert(process_move(board, "Qh5", 0));
+	assert(position_matches(board));
+	location_assign(&loc, 6, 7);
+	assert(square_is_attacked(board, location_getindex(loc), TEAM_WHITE));
+
+	/* A king in check can't step back along the checking line */
+	assert(load_fen(board, "4k3/8/8/8/8/8/8/r3K3 w - - 0 1") == TEAM_WHITE);
+	assert(position_matches(board));
+	king = &(board->White[I_KING]);
+	location_assign(&loc, 6, 1);
+	assert(!can_move_to(board, king, loc));
+	location_assign(&loc, 5, 2);
+	assert(can_move_to(board, king, loc));
+
+	/* or castle through an attacked square */
+	assert(load_fen(board, "4k3/8/8/8/8/8/5r2/R3K2R w KQ - 0 1") == TEAM_WHITE);
+	location_assign(&loc, 7, 1);
+	assert(!can_move_to(board, king, loc));
+	location_assign(&loc, 3, 1);
+	assert(can_move_to(board, king, loc));
+
+	free_game(board);
+}
+
+void test_slider_attacks()
+{
+	const int_fast8_t directions[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+	Bitboard occupancy;
+	uint_fast8_t i, j, k;
+	Game *board = init_game();
+
+	/* Starting position: the c1 bishop and a1 rook are boxed in */
+	assert(bishop_attacks(2, board->occupied[0]) == (BB_SQUARE(9) | BB_SQUARE(11)));
+	assert(rook_attacks(0, board->occupied[0]) == (BB_SQUARE(1) | BB_SQUARE(8)));
+	assert(queen_attacks(3, board->occupied[0]) == (BB_SQUARE(2) | BB_SQUARE(4) | BB_SQUARE(10) | BB_SQUARE(11) | BB_SQUARE(12)));
+	assert(bitboard_count(rook_attacks(27, BB_EMPTY)) == 14);
+	assert(bitboard_count(bishop_attacks(27, BB_EMPTY)) == 13);
+
+	/* Compare against walking the board square by square for a spread of occupancies */
+	occupancy = UINT64_C(0x9e3779b97f4a7c15);
+	for(k = 0; k < 32; k++)
+	{
+		occupancy ^= occupancy << 13;
+		occupancy ^= occupancy >> 7;
+		occupancy ^= occupancy << 17;
+
+		for(i = 0; i < 64; i++)
+		{
+			Bitboard expected[2];
+
+			expected[0] = expected[1] = BB_EMPTY;
+			for(j = 0; j < 8; j++)
+			{
+				int_fast8_t h = i % 8 + directions[j][0];
+				int_fast8_t v = i / 8 + directions[j][1];
+
+				for(; h >= 0 && h < 8 && v >= 0 && v < 8; h += directions[j][0], v += directions[j][1])
+				{
+					expected[j / 4] |= BB_SQUARE(v * 8 + h);
+					if(occupancy & BB_SQUARE(v * 8 + h)) break;
+				}
+			}
+
+			assert(rook_attacks(i, occupancy) == expected[0]);
+			assert(bishop_attacks(i, occupancy) == expected[1]);
+		}
+	}
+
+	free_game(board);
+}
+
+/**
+ * Searches a move buffer for a move.
+ */
+bool buffer_contains(const MoveBuffer *buffer, PackedMove move)
+{
+	uint_fast16_t i;
+	bool ret = false;
+
+	for(i = 0; !ret && i < buffer->count; i++)
+		ret = buffer->moves[i] == move;
+
+	return ret;
+}
+
+void test_movegen()
+{
+	uint_fast8_t i;
+	MoveBuffer buffer;
+	char san[PLY_SAN_LENGTH];
+	Game *board = init_game();
+
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	assert(buffer.count == 20);
+	assert(buffer_contains(&buffer, PM_PACK(12, 28, PM_DOUBLEPUSH)));
+	assert(buffer_contains(&buffer, PM_PACK(6, 21, PM_QUIET)));
+	generate_legal_moves(board, TEAM_BLACK, &buffer);
+	assert(buffer.count == 20);
+
+	/* en passant */
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "a6", 0));
+	assert(process_move(board, "e5", 0));
+	assert(process_move(board, "d5", 0));
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	assert(buffer_contains(&buffer, PM_PACK(36, 43, PM_ENPASSANT)));
+	assert(process_move(board, "Nf3", 0));
+	assert(process_move(board, "Nc6", 0));
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	assert(!buffer_contains(&buffer, PM_PACK(36, 43, PM_ENPASSANT)));
+
+	free_game(board);
+
+
+	/* Scholar's mate */
+	board = init_game();
+
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "e5", 0));
+	assert(process_move(board, "Qh5", 0));
+	assert(process_move(board, "Nc6", 0));
+	assert(process_move(board, "Bc4", 0));
+	assert(process_move(board, "Nf6", 0));
+	assert(has_any_legal_move(board, TEAM_BLACK));
+	assert(process_move(board, "Qxf7", 0));
+	assert(!has_any_legal_move(board, TEAM_BLACK));
+	ply_to_PGN(san, *get_latest_move(board->Moves));
+	assert(string_matches(san, "Qxf7#"));
+
+	free_game(board);
+
+
+	/* Stalemate: black king on a8, white queen on b6 and king on c8 */
+	board = init_game();
+
+	for(i = 0; i < PIECES_PER_SIDE; i++)
+	{
+		capture(board, &(board->White[i]));
+		capture(board, &(board->Black[i]));
+	}
+	command(board, "place 11 b6");
+	command(board, "place 12 c8");
+	command(board, "place 28 a8");
+	assert(!has_any_legal_move(board, TEAM_BLACK));
+	assert(has_any_legal_move(board, TEAM_WHITE));
+
+	free_game(board);
+}
+
+void test_check_info()
+{
+	Game *board = init_game();
+	CheckInfo info;
+	MoveBuffer buffer;
+
+	/* The bishop pins the knight, which then has no moves at all */
+	assert(load_fen(board, "4k3/8/8/8/1b6/8/3N4/4K3 w - - 0 1") == TEAM_WHITE);
+	check_info(board, TEAM_WHITE, &info);
+	assert(info.checkers == BB_EMPTY);
+	assert(info.pinned == BB_SQUARE(11));
+	assert(info.pinRays[11] == (BB_SQUARE(11) | BB_SQUARE(18) | BB_SQUARE(25)));
+	assert(!move_is_legal(board, &info, PM_PACK(11, 26, PM_QUIET)));
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	assert(buffer.count == 4);
+
+	/* A rook check can be blocked, the rook taken, or the king moved off the file */
+	assert(load_fen(board, "4k3/4r3/8/8/8/8/3N4/4K3 w - - 0 1") == TEAM_WHITE);
+	check_info(board, TEAM_WHITE, &info);
+	assert(info.checkers == BB_SQUARE(52));
+	assert(info.evasions == (BB_FILE_A << 4 & ~BB_RANK_1 & ~BB_RANK_8));
+	assert(move_is_legal(board, &info, PM_PACK(11, 20, PM_QUIET)));
+	assert(!move_is_legal(board, &info, PM_PACK(11, 17, PM_QUIET)));
+	assert(!move_is_legal(board, &info, PM_PACK(4, 12, PM_QUIET)));
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	assert(buffer.count == 4);
+
+	/* In double check only the king can move */
+	assert(load_fen(board, "4k3/4r3/8/8/1b6/8/8/4K3 w - - 0 1") == TEAM_WHITE);
+	check_info(board, TEAM_WHITE, &info);
+	assert(bitboard_count(info.checkers) == 2);
+	assert(info.evasions == BB_EMPTY);
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	assert(buffer.count == 3);
+
+	free_game(board);
+}
+
+/* Checks gives_check() against playing every move and looking at the other king, two plies deep */
+static void check_gives_check(Game *board, uint_fast8_t depth)
+{
+	MoveBuffer buffer;
+	uint_fast16_t i;
+
+	generate_legal_moves(board, board->toMove, &buffer);
+
+	for(i = 0; i < buffer.count; i++)
+	{
+		const int_fast8_t color = board->toMove;
+		const bool checks = gives_check(board, color, buffer.moves[i]);
+		CheckInfo info;
+		Undo undo;
+
+		make_move(board, buffer.moves[i], &undo);
+		check_info(board, board->toMove, &info);
+		assert(checks == (info.checkers != BB_EMPTY));
+
+		if(depth > 1) check_gives_check(board, depth - 1);
+		unmake_move(board, &undo);
+	}
+}
+
+void test_gives_check()
+{
+	const char *FENS[] =
+	{
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+		"8/8/8/1k1pP2R/8/8/8/4K3 w - d6 0 1",
+		"1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1"
+	};
+	Game *board = init_game();
+	uint_fast8_t i;
+
+	for(i = 0; i < sizeof(FENS) / sizeof(FENS[0]); i++)
+	{
+		assert(load_fen(board, FENS[i]) == TEAM_WHITE);
+		check_gives_check(board, 2);
+	}
+
+	free_game(board);
+}
+
+void test_fen()
+{
+	Location loc;
+	Game *board = init_game();
+
+	/* The moves played before aren't moves of the new position */
+	assert(process_move(board, "e4", 0));
+	assert(load_fen(board, "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1") == TEAM_WHITE);
+	assert(board->Moves.count == 0 && board->undoCount == 0 && !pop_move(board));
+	assert(position_matches(board));
+	assert(board->castling == (CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE));
+	location_assign(&loc, 1, 3);
+	assert(piece_at(board, loc) == &(board->Black[I_QUEEN]));
+	assert(bitboard_count(board->occupied[TEAM_WHITE]) == 16);
+
+	assert(load_fen(board, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3") == TEAM_WHITE);
+	location_assign(&loc, 6, 6);
+	assert(board->enPassant == loc);
+
+	assert(load_fen(board, "8/8/8/8/8/8/8/8 w - - 0 1") == 0);
+	assert(load_fen(board, "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == 0);
+
+	free_game(board);
+}
+
+void test_perft()
+{
+	Game *board = init_game();
+
+	assert(perft(board, TEAM_WHITE, 1) == 20);
+	assert(perft(board, TEAM_WHITE, 3) == 8902);
+	assert(position_matches(board));
+
+	assert(load_fen(board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1") == TEAM_WHITE);
+	assert(perft(board, TEAM_WHITE, 2) == 2039);
+	assert(position_matches(board));
+
+	free_game(board);
+}
+
+void test_make_move()
+{
+	Game *board = init_game();
+	const Bitboard start = board->occupied[0];
+	Bitboard occupied[3], typeBoards[PIECE_TYPES];
+	MoveBuffer buffer;
+	uint_fast16_t i, j;
+
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "d5", 0));
+	assert(process_move(board, "exd5", 0));
+	assert(board->undoCount == 3);
+	assert(!process_move(board, "Ke7", 0));
+	assert(board->undoCount == 3);
+
+	command(board, "takeback");
+	assert(board->undoCount == 2);
+	assert(whose_turn(board) == TEAM_WHITE);
+	assert(board->Black[I_PAWN4].currentLocation != 0);
+
+	command(board, "takeback");
+	command(board, "undo");
+	assert(board->Moves.count == 0);
+	assert(board->occupied[0] == start);
+	assert(position_matches(board));
+	assert(!pop_move(board));
+
+	/* Every kind of move has to leave the position exactly as it was once it's taken back */
+	assert(load_fen(board, "r3k2r/1P3ppp/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1") == TEAM_WHITE);
+	for(i = 0; i < 3; i++)
+		occupied[i] = board->occupied[i];
+	for(i = 0; i < PIECE_TYPES; i++)
+		typeBoards[i] = board->typeBoards[i];
+
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	for(i = 0; i < buffer.count; i++)
+	{
+		Undo undo;
+
+		make_move(board, buffer.moves[i], &undo);
+		assert(position_matches(board));
+		unmake_move(board, &undo);
+
+		for(j = 0; j < 3; j++)
+			assert(board->occupied[j] == occupied[j]);
+		for(j = 0; j < PIECE_TYPES; j++)
+			assert(board->typeBoards[j] == typeBoards[j]);
+		assert(board->enPassant == 0x46);
+		assert(board->castling == (CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE | CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE));
+		assert(position_matches(board));
+	}
+
+	free_game(board);
+}
+
+void test_game_reset()
+{
+	Game *board = init_game();
+	Game *fresh = init_game();
+	uint_fast16_t i;
+
+	/* Long enough for the history to outgrow the game's block */
+	for(i = 0; i < GAME_ARENA_PLIES / 4 + 10; i++)
+	{
+		assert(process_move(board, "Nf3", 0));
+		assert(process_move(board, "Nf6", 0));
+		assert(process_move(board, "Ng1", 0));
+		assert(process_move(board, "Ng8", 0));
+	}
+	assert(board->Moves.count > GAME_ARENA_PLIES && board->Moves.ownsPlies);
+	assert(board->undoCount > GAME_ARENA_PLIES && board->ownsUndoStack);
+
+	command(board, "takeback");
+	assert(whose_turn(board) == TEAM_BLACK);
+
+	/* A promotion has to be undone by the reset too */
+	assert(load_fen(board, "8/4P3/8/8/8/8/k7/4K3 w - - 0 1") == TEAM_WHITE);
+	assert(process_move(board, "e8=Q", 0));
+
+	game_reset(board);
+	assert(board->Moves.count == 0 && board->undoCount == 0);
+	assert(board->hash == fresh->hash);
+	assert(board->castling == fresh->castling && board->enPassant == 0);
+	assert(whose_turn(board) == TEAM_WHITE);
+	for(i = 0; i < 3; i++)
+		assert(board->occupied[i] == fresh->occupied[i] && board->attacked[i] == fresh->attacked[i]);
+	for(i = 0; i < PIECE_TYPES; i++)
+		assert(board->typeBoards[i] == fresh->typeBoards[i]);
+	assert(position_matches(board));
+
+	assert(process_move(board, "e4", 0));
+	assert(board->Moves.count == 1);
+
+	free_game(fresh);
+	free_game(board);
+}
+
+void test_game_clone()
+{
+	Game *board = init_game();
+	Game *copy, *other;
+	StatusCache *cache = status_cache_init(100);
+	uint_fast16_t i;
+
+	board->statusCache = cache;
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "d5", 0));
+	assert(process_move(board, "exd5", 0));
+
+	copy = game_clone(board);
+	assert(copy->hash == board->hash && copy->Moves.count == 3 && copy->undoCount == 3);
+	assert(position_matches(copy));
+
+	/* The copy doesn't share the original's cache, so another thread can own it */
+	assert(copy->statusCache == NULL && board->statusCache == cache);
+
+	/* Playing on the copy leaves the original alone */
+	assert(process_move(copy, "Qxd5", 0));
+	assert(board->Black[I_QUEEN].currentLocation == 0x48);
+	assert(board->Moves.count == 3 && whose_turn(board) == TEAM_BLACK);
+
+	command(copy, "takeback");
+	command(copy, "takeback");
+	assert(copy->Black[I_PAWN4].currentLocation == 0x45);
+	assert(position_matches(copy));
+	assert(position_matches(board));
+
+	/* Only the position is copied */
+	other = init_game();
+	assert(process_move(other, "Nf3", 0));
+	game_copy_position(other, board);
+	assert(other->hash == board->hash && whose_turn(other) == TEAM_BLACK);
+	assert(other->Moves.count == 0 && !pop_move(other));
+	assert(position_matches(other));
+	assert(process_move(other, "Qxd5", 0));
+
+	free_game(copy);
+
+	/* A history that has outgrown its block is copied too */
+	for(i = 0; i < GAME_ARENA_PLIES / 4 + 10; i++)
+	{
+		assert(process_move(other, "Nf3", 0));
+		assert(process_move(other, "Nc6", 0));
+		assert(process_move(other, "Ng1", 0));
+		assert(process_move(other, "Nb8", 0));
+	}
+	copy = game_clone(other);
+	assert(copy->Moves.count == other->Moves.count && copy->undoCount == other->undoCount);
+	while(pop_move(copy))
+		;
+	assert(position_matches(copy));
+	assert(copy->hash == board->hash);
+	assert(position_matches(other));
+
+	free_game(copy);
+	free_game(other);
+	free_game(board);
+	status_cache_free(cache);
+}
+
+void test_replay()
+{
+	Game *board = init_game();
+	PGNReader reader;
+	Replay replay;
+	FILE *fp = tmpfile();
+
+	assert(fp != NULL);
+	fputs("[Event \"Scholar's mate\"]\n1. e4 $1 e5 (1... c5 2. Nf3 (2. d4 $6)) 2. Qh5 Nc6 3. Bf1-c4!? Ng8-f6?? 4. Qh5xf7#!! 1-0\n", fp);
+	fputs("1. d4 d5 2. Kd2 Kd7 3. Kd3 Kd6 4. Kd4 *\n", fp);
+	fputs("1. e4 e5\n", fp);
+	rewind(fp);
+
+	pgn_from_stream(&reader, fp, true);
+
+	assert(replay_game(board, &reader, &replay));
+	assert(replay.plies == 7 && string_matches(replay.result, "1-0") && replay.illegal[0] == '\0');
+	assert(string_matches(board->Moves.result, "1-0"));
+	assert(get_latest_move(board->Moves)->notes & PLY_MATE);
+
+	/* The next game in the file carries on from where the last one stopped */
+	game_reset(board);
+	assert(!replay_game(board, &reader, &replay));
+	assert(replay.plies == 6 && string_matches(replay.illegal, "Kd4") && string_matches(replay.result, "*"));
+
+	/* It stopped on the move, so the rest of that game is still to be read */
+	game_reset(board);
+	assert(replay_game(board, &reader, &replay));
+	assert(replay.plies == 0 && string_matches(replay.result, "*"));
+
+	/* A game that stops without a result is unfinished */
+	game_reset(board);
+	assert(replay_game(board, &reader, &replay));
+	assert(replay.plies == 2 && string_matches(replay.result, "*") && board->Moves.result[0] == '\0');
+
+	game_reset(board);
+	assert(replay_game(board, &reader, &replay));
+	assert(replay.plies == 0);
+
+	pgn_close(&reader);
+	fclose(fp);
+	free_game(board);
+}
+
+void test_batch_replay()
+{
+	BatchReport report;
+	uintmax_t i;
+	char PGN[256], INDEX[256];
+	FILE *fp;
+
+	temp_path(PGN, 256, "test_batch_replay.pgn");
+	temp_path(INDEX, 256, "test_batch_replay.pgn.idx");
+
+	fp = fopen(PGN, "w");
+	assert(fp != NULL);
+
+	/* Enough games that every thread gets some */
+	for(i = 0; i < 4 * BATCH_CHUNK; i++)
+		fputs("[Result \"0-1\"]\n1. f3 e5 2. g4 Qh4# 0-1\n\n", fp);
+	fputs("[Result \"0-1\"]\n1. e4 e5 1-0\n\n", fp);
+	fputs("[Result \"1-0\"]\n1. f3 e5 2. g4 Qh4# 1-0\n\n", fp);
+	fputs("1. e4 Ke7 *\n\n", fp);
+	fputs("1. e4 e5 *\n", fp);
+	fclose(fp);
+
+	assert(batch_replay(PGN, 3, &report));
+	assert(report.threads == 3);
+	assert(report.games == 4 * BATCH_CHUNK + 4);
+	assert(report.plies == 4 * 4 * BATCH_CHUNK + 2 + 4 + 1 + 2);
+	assert(report.illegal == 1 && report.mismatches == 2);
+
+	/* The problems come out in the order of the file, whichever thread found them */
+	assert(report.problemCount == 3);
+	assert(report.problems[0].number == 4 * BATCH_CHUNK + 1 && string_matches(report.problems[0].tag, "0-1"));
+	assert(report.problems[1].number == 4 * BATCH_CHUNK + 2 && string_matches(report.problems[1].board, "0-1"));
+	assert(report.problems[2].number == 4 * BATCH_CHUNK + 3 && string_matches(report.problems[2].replay.illegal, "Ke7"));
+
+	free_batch_report(&report);
+
+	remove(PGN);
+	remove(INDEX);
+}
+
+void test_zobrist()
+{
+	Game *board = init_game();
+	const uint_least64_t start = board->hash;
+	uint_least64_t afterE5, key;
+	MoveBuffer buffer;
+	uint_fast16_t i;
+
+	assert(start == zobrist_compute(board));
+
+	/* The knights going out and coming back is the same position */
+	assert(process_move(board, "Nf3", 0));
+	assert(board->hash != start);
+	assert(board->hash == zobrist_compute(board));
+	assert(process_move(board, "Nf6", 0));
+	assert(process_move(board, "Ng1", 0));
+	assert(process_move(board, "Ng8", 0));
+	assert(board->hash == start);
+
+	/* but a king that went out and came back can't castle any more */
+	assert(process_move(board, "e4", 0));
+	assert(process_move(board, "e5", 0));
+	afterE5 = board->hash;
+	assert(process_move(board, "Ke2", 0));
+	assert(process_move(board, "Ke7", 0));
+	assert(process_move(board, "Ke1", 0));
+	assert(process_move(board, "Ke8", 0));
+	assert(board->hash != afterE5);
+	assert(board->hash == zobrist_compute(board));
+
+	/* The en passant square and the side to move are part of the key */
+	assert(load_fen(board, "r3k2r/1P3ppp/8/3pP3/8/8/8/R3K2R w KQkq - 0 1") == TEAM_WHITE);
+	key = board->hash;
+	assert(load_fen(board, "r3k2r/1P3ppp/8/3pP3/8/8/8/R3K2R b KQkq - 0 1") == TEAM_BLACK);
+	assert(board->hash != key);
+	assert(load_fen(board, "r3k2r/1P3ppp/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1") == TEAM_WHITE);
+	assert(board->hash != key);
+	key = board->hash;
+
+	/* Castling, en passant and promotions all have to keep the key right */
+	generate_legal_moves(board, TEAM_WHITE, &buffer);
+	for(i = 0; i < buffer.count; i++)
+	{
+		Undo undo;
+
+		make_move(board, buffer.moves[i], &undo);
+		assert(board->hash == zobrist_compute(board));
+		unmake_move(board, &undo);
+		assert(board->hash == key);
+	}
+
+	free_game(board);
+}
+
+void test_status_cache()
+{
+	Game *board = init_game();
+	StatusCache *cache = status_cache_init(100);
+	char san[PLY_SAN_LENGTH];
+
+	assert(cache->mask == 63);
+	board->statusCache = cache;
+
+	/* Playing a move works out its check and mate without asking the cache */
+	assert(process_move(board, "f3", 0));
+	assert(process_move(board, "e5", 0));
+	assert(process_move(board, "g4", 0));
+	assert(process_move(board, "Qh4", 0));
+	ply_to_PGN(san, *get_latest_move(board->Moves));
+	assert(string_matches(san, "Qh4#"));
+	assert(cache->hits == 0 && cache->misses == 0);
+
+	assert(position_status(board) == (CHECK_YES | CHECK_MATE));
+	assert(cache->hits == 0 && cache->misses == 1);
+
+	/* Coming back to the same position finds the answer in the cache */
+	command(board, "takeback");
+	assert(process_move(board, "Qh4", 0));
+	assert(position_status(board) == (CHECK_YES | CHECK_MATE));
+	assert(cache->hits == 1 && cache->misses == 1);
+
+	assert(load_fen(board, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1") == TEAM_BLACK);
+	assert(position_status(board) == CHECK_STALEMATE);
+
+	status_cache_clear(cache);
+	assert(cache->hits == 0 && cache->misses == 0);
+	assert(position_status(board) == CHECK_STALEMATE);
+	assert(cache->misses == 1);
+
+	free_game(board);
+	status_cache_free(cache);
+}
+
 void test_pawns()
 {
 	test_pawn_capture();
 	test_pawn_forward();
+	test_en_passant();
 }
 
 void test_pieces()
 {
 	test_piece_placement();
 	test_castling();
+	test_castling_rights();
 	test_pawns();
 }
 
 void test_functions()
 {
-	test_decipher();
+	test_san_parse();
+	test_san_resolve();
 	test_move();
+	test_move_list();
+	test_pgn_reader();
+	test_pgn_index();
 	test_string_remove();
 	test_string_count_occurences();
 	test_string_split();
+	test_tokenizer();
 	test_string_cat();
-	test_tokenize();
 }
 
 void testall()
 {
 	test_macros();
 	test_pieces();
+	test_bitboards();
+	test_mailbox();
+	test_attack_tables();
+	test_slider_attacks();
+	test_attack_maps();
+	test_movegen();
+	test_fen();
+	test_check_info();
+	test_gives_check();
+	test_perft();
+	test_make_move();
+	test_game_reset();
+	test_game_clone();
+	test_replay();
+	test_batch_replay();
+	test_zobrist();
+	test_status_cache();
 	test_functions();
 }
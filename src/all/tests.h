@@ -8,7 +8,8 @@
 void test_PGN_macros();
 
 
-void test_decipher();
+void test_san_parse();
+void test_san_resolve();
 void test_move();
 
 
@@ -1,116 +1,221 @@
 #include "turn.h"
 
+/*
+ * The moves are kept as one array of plies that doubles in size whenever it fills up,
+ * so adding a move is amortized O(1) and any turn can be found straight from its number.
+ * A ply is a PackedMove and a byte of notes, so nothing is allocated per move and the SAN
+ * is only written out by ply_to_PGN() when a move is shown.
+ */
+
+/* The SAN letter of each piece type by TYPE_INDEX(). Pawns don't have one */
+static const char PLY_SYMBOLS[PIECE_TYPES] = { '\0', 'B', 'R', 'Q', 'N', 'K' };
+
+/* What a pawn becomes by the lowest 2 bits of a promotion's PM_ flags */
+static const char PLY_PROMOTIONS[4] = { 'N', 'B', 'R', 'Q' };
+
+void init_move_list(MoveList *ML)
+{
+	init_move_list_with(ML, NULL, 0);
+}
+
+/**
+ * Starts an empty list that keeps its first plies in storage it doesn't own. Once that
+ * fills up the plies are copied onto the heap and the storage isn't touched again.
+ *
+ * @param ML        The list being initialized
+ * @param storage   Room for the first plies
+ * @param capacity  How many plies fit in storage
+ */
+void init_move_list_with(MoveList *ML, Ply *storage, uintmax_t capacity)
+{
+	ML->plies = storage;
+	ML->count = 0;
+	ML->capacity = capacity;
+	ML->ownsPlies = storage == NULL;
+	ML->result[0] = '\0';
+}
+
+/**
+ * Empties the list but keeps the storage it has, so it can be filled again
+ * without allocating.
+ *
+ * @param ML  The list being emptied
+ */
+void clear_move_list(MoveList *ML)
+{
+	ML->count = 0;
+	ML->result[0] = '\0';
+}
+
 /**
- * Given a specified move number, the function will return the associated turn object
+ * Frees the list's plies if they're its own.
+ *
+ * @param ML  The list being freed. It's left empty and can be used again
+ */
+void free_move_list(MoveList *ML)
+{
+	if(ML->ownsPlies) free(ML->plies);
+
+	init_move_list(ML);
+}
+
+/*
+ * Writes the SAN of the half move at index into destStr. The game's result takes the slot after
+ * the last ply once it's known. destStr is left empty if there's nothing in that slot.
+ */
+static void slot_to_PGN(char *destStr, const MoveList *ML, uintmax_t index)
+{
+	if(index < ML->count)
+		ply_to_PGN(destStr, ML->plies[index]);
+	else if(index == ML->count)
+		string_copy(destStr, ML->result);
+	else
+		destStr[0] = '\0';
+}
+
+/**
+ * Given a specified move number, the function will return the associated turn
  * of that move if it exists.
  *
- * @param board  The game instance being played
- * @param num    The move number the person calling the function wants
+ * @param ML   The list of moves
+ * @param num  The move number the person calling the function wants
  *
- * @return       NULL if there is no move that matches num. Returns a turn object
- *               with the number field equal to num
+ * @return     A turn with the number field equal to num. Its White field is empty
+ *             if there is no move that matches num
  */
-Turn *get_move_number(MoveList ML, uintmax_t num)
+Turn get_move_number(MoveList ML, uintmax_t num)
 {
-	Turn *ret = NULL;
-	if(num > 0 && num <= ML.num)
+	Turn ret;
+
+	ret.number = num;
+	ret.White[0] = '\0';
+	ret.Black[0] = '\0';
+
+	if(num > 0 && num <= get_turn_count(ML))
 	{
-		for(ret = ML.firstMove; ret->number != num; ret = ret->next);
+		slot_to_PGN(ret.White, &ML, 2 * (num - 1));
+		slot_to_PGN(ret.Black, &ML, 2 * num - 1);
 	}
 
 	return ret;
 }
 
-void add_move(MoveList *ML, char *str)
+/**
+ * @return the number of turns that have been started, counting the result as a move
+ */
+uintmax_t get_turn_count(MoveList ML)
 {
-	if(ML->LatestMove == NULL)
-	{
-		ML->LatestMove = malloc(sizeof(Turn));
-		ML->LatestMove->next = NULL;
-		ML->LatestMove->number = 1;
+	return (ML.count + (ML.result[0] != '\0') + 1) / 2;
+}
 
-		ML->LatestMove->White = str;
-		ML->LatestMove->Black = NULL;
+/**
+ * @return the latest ply played, or NULL if there isn't one
+ */
+Ply *get_latest_move(MoveList ML)
+{
+	return ML.count == 0 ? NULL : &(ML.plies[ML.count - 1]);
+}
 
-		ML->firstMove = ML->LatestMove;
-		ML->num = 1;
-	}
-	else if(ML->LatestMove->Black != NULL)
+void add_move(MoveList *ML, Ply ply)
+{
+	if(ML->count == ML->capacity)
 	{
-		uintmax_t newNum = ML->LatestMove->number + 1;
-
-		ML->LatestMove->next = malloc(sizeof(Turn));
+		Ply *grown;
 
-		ML->LatestMove = ML->LatestMove->next;
-		ML->LatestMove->number = newNum;
-		ML->LatestMove->next = NULL;
+		ML->capacity = ML->capacity == 0 ? 64 : 2 * ML->capacity;
+		grown = realloc(ML->ownsPlies ? ML->plies : NULL, ML->capacity * sizeof(Ply));
+		assert(grown != NULL);
 
-		ML->LatestMove->White = str;
-		ML->LatestMove->Black = NULL;
-		
-		ML->num++;
-	}
-	else
-	{
-		ML->LatestMove->Black = str;
+		if(!ML->ownsPlies) memcpy(grown, ML->plies, ML->count * sizeof(Ply));
+		ML->plies = grown;
+		ML->ownsPlies = true;
 	}
+
+	ML->plies[ML->count++] = ply;
 }
 
-void update_latest_move(MoveList *ML, char *newStr)
+void remove_latest_move(MoveList *ML)
 {
-	if(ML->LatestMove != NULL)
-	{
-		if(ML->LatestMove->Black == NULL)
-		{
-			ML->LatestMove->White = newStr;
-		}
-		else
-		{
-			ML->LatestMove->Black = newStr;
-		}
-	}
+	if(ML->count > 0)
+		ML->count--;
 }
 
-void remove_latest_move(MoveList *ML)
+/**
+ * Records how the game ended.
+ *
+ * @param ML      The game's list of moves
+ * @param result  1-0, 0-1, 1/2-1/2 or *
+ */
+void set_result(MoveList *ML, const char *result)
 {
-	if(ML->firstMove != NULL && ML->num > 0)
+	assert(string_getlen(result) < RESULT_LENGTH);
+
+	string_copy(ML->result, result);
+}
+
+/**
+ * Writes out a ply in standard algebraic notation, the way moves are written in
+ * portable game notation. (https://en.wikipedia.org/wiki/Portable_Game_Notation)
+ *
+ * @param destStr  Where the SAN is written to. It needs room for PLY_SAN_LENGTH chars
+ * @param ply      The ply being written out
+ */
+void ply_to_PGN(char *destStr, Ply ply)
+{
+	const uint_fast8_t from = PM_FROM(ply.move);
+	const uint_fast8_t to = PM_TO(ply.move);
+	const uint_fast8_t flags = PM_FLAGS(ply.move);
+	const uint_fast8_t type = ply.notes & PLY_TYPEMASK;
+	uint_fast8_t len = 0;
+
+	if(flags == PM_CASTLE_KINGSIDE || flags == PM_CASTLE_QUEENSIDE)
 	{
-		assert(ML->LatestMove->next == NULL);
+		string_copy(destStr, flags == PM_CASTLE_KINGSIDE ? "O-O" : "O-O-O");
+		len = string_getlen(destStr);
+	}
+	else
+	{
+		if(type != TYPE_INDEX(PIECE_PAWN))
+			destStr[len++] = PLY_SYMBOLS[type];
+		else if(flags & PM_CAPTURE)
+			destStr[len++] = 'a' + from % 8;
 
-		if(ML->num == 1)
-		{
-			free(ML->LatestMove);
-			ML->firstMove = NULL;
-			ML->LatestMove = NULL;
-			ML->num--;
-		}
-		else if(ML->LatestMove->Black == NULL)
-		{
-			Turn *latest = ML->LatestMove;
+		if(ply.notes & PLY_FILESPECIFIED)
+			destStr[len++] = 'a' + from % 8;
+		if(ply.notes & PLY_RANKSPECIFIED)
+			destStr[len++] = '1' + from / 8;
 
-			Turn *previous = get_move_number(*ML, ML->num - 1);
-                        
-			free(latest);
-			ML->LatestMove = previous;
-			ML->num--;
-		}
-		else
+		if(flags & PM_CAPTURE)
+			destStr[len++] = 'x';
+
+		destStr[len++] = 'a' + to % 8;
+		destStr[len++] = '1' + to / 8;
+
+		if(flags & PM_PROMOTION)
 		{
-			ML->LatestMove->Black = NULL;
+			destStr[len++] = '=';
+			destStr[len++] = PLY_PROMOTIONS[flags & PM_PROMOTIONMASK];
 		}
 	}
+
+	if(ply.notes & PLY_MATE)
+		destStr[len++] = '#';
+	else if(ply.notes & PLY_CHECK)
+		destStr[len++] = '+';
+
+	destStr[len] = '\0';
 }
 
 void print_moves(MoveList ML)
 {
-	Turn *current;
+	uintmax_t i;
 
 	printf("\n\n");
 
-	for(current = ML.firstMove; current != NULL; current = current->next)
+	for(i = 1; i <= get_turn_count(ML); i++)
 	{
-		char *black = current->Black == NULL ? "" : current->Black;
+		Turn current = get_move_number(ML, i);
 
-		printf("%" PRIiMAX "\t%s\t%s\n", current->number, current->White, black);
+		printf("%" PRIiMAX "\t%s\t%s\n", current.number, current.White, current.Black);
 	}
 }
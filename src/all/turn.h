@@ -4,30 +4,51 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "char.h"
+#include "macros.h"
 
+typedef uint_least16_t PackedMove;      /* see the PM_ macros */
+
+/* One half move of a game's history. Its SAN is only written out when it's shown */
+typedef struct ply
+{
+    PackedMove move;
+    uint_least8_t notes;    /* the PLY_ flags */
+} Ply;
+
+/* One numbered turn: the SAN of white's move and black's reply, which is empty if black hasn't moved yet */
 typedef struct turn
 {
     uintmax_t number;
-    char *White;
-    char *Black;
-    struct turn *next;
+    char White[PLY_SAN_LENGTH];
+    char Black[PLY_SAN_LENGTH];
 } Turn;
 
 typedef struct move_list
 {
-    uintmax_t num;
-    Turn *firstMove;
-    Turn *LatestMove;
+    Ply *plies;                 /* every half move in the order they were played, white's first */
+    uintmax_t count;
+    uintmax_t capacity;
+    bool ownsPlies;             /* false while plies is storage lent by someone else, e.g. a game's block */
+    char result[RESULT_LENGTH]; /* 1-0, 0-1, 1/2-1/2 or *, empty while the game goes on */
 } MoveList;
 
-Turn *get_move_number(MoveList, uintmax_t);
+void init_move_list(MoveList*);
+void init_move_list_with(MoveList*, Ply*, uintmax_t);
+void clear_move_list(MoveList*);
+void free_move_list(MoveList*);
+
+Turn get_move_number(MoveList, uintmax_t);
+uintmax_t get_turn_count(MoveList);
+Ply *get_latest_move(MoveList);
 
-void add_move(MoveList*, char*);
-void update_latest_move(MoveList*, char*);
+void add_move(MoveList*, Ply);
 void remove_latest_move(MoveList*);
+void set_result(MoveList*, const char*);
 
+void ply_to_PGN(char*, Ply);
 void print_moves(MoveList);
 
 #endif /* TURN_H_INCLUDED */
@@ -0,0 +1,91 @@
+#include "zobrist.h"
+
+/*
+ * A Zobrist key identifies a position with one 64 bit number: every piece on every square,
+ * every set of castling rights, every en passant file and the side to move get a random
+ * key, and a position's key is all of its keys xored together. Moving a piece only xors
+ * a couple of keys in and out, so the key can be kept up to date as moves are played.
+ */
+
+uint_least64_t ZOBRIST_PIECES[2][PIECE_TYPES][64];
+uint_least64_t ZOBRIST_CASTLING[16];
+uint_least64_t ZOBRIST_EN_PASSANT[8];
+uint_least64_t ZOBRIST_BLACK_TO_MOVE;
+
+static bool initialized = false;
+
+/* xorshift64*, seeded the same way every run so keys (and anything saved with them) stay the same */
+static uint_least64_t next_random(uint_least64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	*state &= UINT64_C(0xffffffffffffffff);
+
+	return (*state * UINT64_C(0x2545f4914f6cdd1d)) & UINT64_C(0xffffffffffffffff);
+}
+
+/**
+ * Fills the Zobrist key tables. Has to be called before any key is used.
+ * Calling it again does nothing.
+ */
+void zobrist_init()
+{
+	if(!initialized)
+	{
+		uint_least64_t state = UINT64_C(0x9e3779b97f4a7c15);
+		uint_fast8_t color, type, i;
+
+		for(color = 0; color < 2; color++)
+			for(type = 0; type < PIECE_TYPES; type++)
+				for(i = 0; i < 64; i++)
+					ZOBRIST_PIECES[color][type][i] = next_random(&state);
+
+		/* Each castling right gets a key and every combination is the xor of its rights */
+		for(i = 0; i < 4; i++)
+			ZOBRIST_CASTLING[1 << i] = next_random(&state);
+		ZOBRIST_CASTLING[0] = 0;
+		for(i = 1; i < 16; i++)
+			ZOBRIST_CASTLING[i] = ZOBRIST_CASTLING[i & (i - 1)] ^ ZOBRIST_CASTLING[i & -i];
+
+		for(i = 0; i < 8; i++)
+			ZOBRIST_EN_PASSANT[i] = next_random(&state);
+
+		ZOBRIST_BLACK_TO_MOVE = next_random(&state);
+
+		initialized = true;
+	}
+}
+
+/**
+ * Works out a position's Zobrist key from scratch. The game keeps its key up to date
+ * as moves are played, so this is for setting a position up and for checking the
+ * incremental updates.
+ *
+ * @param board  The game instance being played
+ *
+ * @return the key of the current position
+ */
+uint_least64_t zobrist_compute(const Game *board)
+{
+	uint_least64_t ret = 0;
+	uint_fast8_t i;
+
+	for(i = 0; i < 2 * PIECES_PER_SIDE; i++)
+	{
+		const Piece *p = i < PIECES_PER_SIDE ? &(board->White[i]) : &(board->Black[i - PIECES_PER_SIDE]);
+
+		if(p->currentLocation != 0)
+			ret ^= ZOBRIST_PIECES[p->color - 1][TYPE_INDEX(p->type)][location_getindex(p->currentLocation)];
+	}
+
+	ret ^= ZOBRIST_CASTLING[board->castling];
+
+	if(board->enPassant != 0)
+		ret ^= ZOBRIST_EN_PASSANT[location_getfile(board->enPassant) - 1];
+
+	if(board->toMove == TEAM_BLACK)
+		ret ^= ZOBRIST_BLACK_TO_MOVE;
+
+	return ret;
+}
@@ -0,0 +1,15 @@
+#ifndef ZOBRIST_H_INCLUDED
+#define ZOBRIST_H_INCLUDED
+
+#include "chess.h"
+
+/* Index the piece keys with color - 1, TYPE_INDEX() and the square */
+extern uint_least64_t ZOBRIST_PIECES[2][PIECE_TYPES][64];
+extern uint_least64_t ZOBRIST_CASTLING[16];
+extern uint_least64_t ZOBRIST_EN_PASSANT[8];
+extern uint_least64_t ZOBRIST_BLACK_TO_MOVE;
+
+void zobrist_init();
+uint_least64_t zobrist_compute(const Game*);
+
+#endif /* ZOBRIST_H_INCLUDED */
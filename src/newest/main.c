@@ -1,7 +1,14 @@
+#include "../all/batch.h"
 #include "../all/chess.h"
 #include "../all/commands.h"
 #include "../all/filereading.h"
 #include "../all/mischelp.h"
+#include "../all/movegen.h"
+#include "../all/perft.h"
+#include "../all/pgnindex.h"
+#include "../all/replay.h"
+#include "../all/san.h"
+#include "../all/statuscache.h"
 #include "../all/logichelp.h"
 #include "../all/tests.h"
 
@@ -9,11 +16,21 @@ typedef struct
 {
 	int_fast8_t flags;
 	bool do_tests;
+	bool do_perft;
+	bool do_pgnbench;
+	bool do_sanbench;
+	bool do_replay;
+	bool do_batch;
 	char *filename;
+	uintmax_t game;     /* which game of the file to open, counting from 1 */
+	uint_fast16_t threads;  /* how many threads -batch replays on, 0 for one per processor */
 } clargs_t;
 
 clargs_t process_clargs(int, char*[]);
+void open_game(PGNReader*, clargs_t);
 void play(clargs_t);
+void replay(clargs_t);
+void batch(clargs_t);
 int_fast8_t mainloop(Game*, clargs_t);
 
 
@@ -33,8 +50,15 @@ clargs_t process_clargs(int argc, char *argv[])
 	clargs_t ret;
 
 	ret.filename = NULL;
+	ret.game = 1;
 	ret.flags = ML_SHOWMOVES | ML_CLEAR;
 	ret.do_tests = false;
+	ret.do_perft = false;
+	ret.do_pgnbench = false;
+	ret.do_sanbench = false;
+	ret.do_replay = false;
+	ret.do_batch = false;
+	ret.threads = 0;
 
 	if(argc > 1)
 	{
@@ -47,6 +71,29 @@ clargs_t process_clargs(int argc, char *argv[])
 				ret.flags |= ML_SHOWRUNTIME;
 			else if(string_matches(argv[i], "-test"))
 				ret.do_tests = true;
+			else if(string_matches(argv[i], "-perft"))
+				ret.do_perft = true;
+			else if(string_matches(argv[i], "-pgnbench"))
+			{
+				ret.do_pgnbench = true;
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					ret.filename = argv[++i];
+			}
+			else if(string_matches(argv[i], "-sanbench"))
+				ret.do_sanbench = true;
+			else if(string_matches(argv[i], "-replay"))
+				ret.do_replay = true;
+			else if(string_matches(argv[i], "-batch"))
+				ret.do_batch = true;
+			else if(string_matches(argv[i], "-threads"))
+			{
+				bool NO_THREAD_COUNT_PROVIDED;
+				i++;
+				NO_THREAD_COUNT_PROVIDED = i < argc && strtoul(argv[i], NULL, 10) > 0;
+				assert(NO_THREAD_COUNT_PROVIDED);
+
+				ret.threads = strtoul(argv[i], NULL, 10);
+			}
 			else if(string_matches(argv[i], "-nomoves"))
 				ret.flags &= ~PB_SHOWMOVES;
 			else if(string_matches(argv[i], "-noclear"))
@@ -60,26 +107,152 @@ clargs_t process_clargs(int argc, char *argv[])
 
 				ret.filename = argv[i];
 			}
+			else if(string_matches(argv[i], "-game"))
+			{
+				bool NO_GAME_NUMBER_PROVIDED;
+				i++;
+				NO_GAME_NUMBER_PROVIDED = i < argc && strtoul(argv[i], NULL, 10) > 0;
+				assert(NO_GAME_NUMBER_PROVIDED);
+
+				ret.game = strtoul(argv[i], NULL, 10);
+			}
 		}
 	}
 
 	return ret;
 }
 
+/**
+ * Opens the game the command line asked for, the one -game picked out of the -open file.
+ *
+ * @param reader  Set up to read the game's moves
+ * @param args    The command line
+ */
+void open_game(PGNReader *reader, clargs_t args)
+{
+	if(string_matches(args.filename, "-"))
+		pgn_open(reader, args.filename);
+	else
+	{
+		/* Only the one game is read, wherever it is in the file */
+		PGNIndex index;
+		PGNGame game;
+		bool FILE_DOESNT_EXIST, FILE_HAS_FEWER_GAMES;
+
+		FILE_DOESNT_EXIST = pgn_index_open(&index, args.filename);
+		assert(FILE_DOESNT_EXIST);
+		FILE_HAS_FEWER_GAMES = pgn_index_game(&index, args.game, &game);
+		assert(FILE_HAS_FEWER_GAMES);
+		pgn_index_close(&index);
+
+		FILE_DOESNT_EXIST = pgn_open_range(reader, args.filename, game.offset, game.length);
+		assert(FILE_DOESNT_EXIST);
+	}
+}
+
+/**
+ * Plays the moves of the -open game back to back without showing the board or reading
+ * from the terminal, then prints how it went. Exits with 1 if a move couldn't be played.
+ *
+ * @param args  The command line
+ */
+void replay(clargs_t args)
+{
+	Game *G;
+	PGNReader reader;
+	Replay summary;
+	bool NO_FILE_TO_REPLAY = args.filename != NULL, legal;
+
+	assert(NO_FILE_TO_REPLAY);
+
+	G = init_game();
+	G->statusCache = status_cache_init(STATUS_CACHE_ENTRIES);
+
+	open_game(&reader, args);
+	legal = replay_game(G, &reader, &summary);
+	pgn_close(&reader);
+
+	print_replay(&summary);
+
+	status_cache_free(G->statusCache);
+	free_game(G);
+
+	if(!legal) exit(1);
+}
+
+/**
+ * Replays every game of the -open file on a pool of threads and prints what was wrong with
+ * any of them and how fast it went. Exits with 1 if any game had an illegal move or a result
+ * that doesn't add up.
+ *
+ * @param args  The command line
+ */
+void batch(clargs_t args)
+{
+	BatchReport report;
+	bool NO_FILE_TO_REPLAY = args.filename != NULL && !string_matches(args.filename, "-"), FILE_DOESNT_EXIST, clean;
+
+	assert(NO_FILE_TO_REPLAY);
+
+	FILE_DOESNT_EXIST = batch_replay(args.filename, args.threads, &report);
+	assert(FILE_DOESNT_EXIST);
+
+	print_batch_report(&report);
+	clean = report.illegal == 0 && report.mismatches == 0;
+	free_batch_report(&report);
+
+	if(!clean) exit(1);
+}
+
 void play(clargs_t args)
 {
 	Game *G;
+	StatusCache *cache;
 	int_fast8_t result;
 
 	if(args.do_tests) testall();
 
-	G = NULL;
-	result = -1;
-	while(result == -1)
+	if(args.do_perft)
+	{
+		if(!perft_suite()) exit(1);
+		return;
+	}
+
+	if(args.do_pgnbench)
+	{
+		pgn_benchmark(args.filename);
+		return;
+	}
+
+	if(args.do_sanbench)
 	{
-		if(G != NULL) free_game(G);
-		G = init_game();
-		result = mainloop(G, args);
+		san_benchmark();
+		return;
+	}
+
+	if(args.do_batch)
+	{
+		batch(args);
+		return;
+	}
+
+	if(args.do_replay)
+	{
+		replay(args);
+		return;
+	}
+
+	/* The cache outlives each game so *reset is the only thing that empties it */
+	cache = status_cache_init(STATUS_CACHE_ENTRIES);
+
+	G = init_game();
+	G->statusCache = cache;
+
+	/* *reset starts over in the same game without going back to the allocator */
+	while((result = mainloop(G, args)) == ML_RESET)
+	{
+		game_reset(G);
+		status_cache_clear(cache);
 	}
 
 	if(result != ML_QUIT)
@@ -109,35 +282,24 @@ void play(clargs_t args)
 
 		fgets(dummy, 3, stdin);
 	}
+	else
+		free_game(G);
+
+	status_cache_free(cache);
 }
 
 
 int_fast8_t mainloop(Game *board, clargs_t clargenborgen)
 {
-	bool readingFile, game_end;
-	char **filemoves;
+	bool readingFile, readingStdin, game_end;
+	PGNReader reader;
 	int_fast8_t flags, stalemate, checkmate;
-	uintmax_t filemoves_size, k;
 
 
 	readingFile = clargenborgen.filename != NULL;
-	filemoves = NULL;
-	k = 0;
+	readingStdin = readingFile && string_matches(clargenborgen.filename, "-");
 
-	if(readingFile)
-	{
-		filemoves = get_moves_from_file(clargenborgen.filename, &filemoves_size);
-
-		/*
-		uintmax_t i = 0;
-		do
-		{
-		printf("%s, ", filemoves[i]);
-		} while(++i < filemoves_size);
-		*/
-
-		assert(string_matches_end(filemoves[filemoves_size - 1]));
-	}
+	if(readingFile) open_game(&reader, clargenborgen);
 
 
 
@@ -157,22 +319,33 @@ int_fast8_t mainloop(Game *board, clargs_t clargenborgen)
 			if(flags & ML_CLEAR) ClearScreen();
 			print_board(board, (flags & (PB_SHOWMOVES | PB_RUNTIME)));
 
-			fgets(input, 100, stdin);
-			input[99] = char_array_contains(input, 100, '\0') ? '\0' : input[99];
-			string_remove(input, string_getlen(input) - 1); /* remove the newline character at the end of fgets */
-			userinput = !readingFile ? input : filemoves[k++];
+			/* A game read from stdin can't wait for a key press there too, so its moves follow one after another */
+			if(!readingStdin)
+			{
+				fgets(input, 100, stdin);
+				input[99] = char_array_contains(input, 100, '\0') ? '\0' : input[99];
+				string_remove(input, string_getlen(input) - 1); /* remove the newline character at the end of fgets */
+			}
+			userinput = input;
+			if(readingFile)
+			{
+				Slice token;
+
+				/* A game that stops without a result is unfinished */
+				if(pgn_next_token(&reader, &token))
+					slice_copy(input, 100, token);
+				else
+					string_copy(input, "*");
+			}
 
 			if(readingFile && string_matches_end(userinput))
 			{
-				char *adding;
 				if(string_matches(userinput, "*"))
 					stalemate = PB_CONTINUED;
 				else if(string_matches(userinput, "1/2-1/2"))
 					stalemate = PB_STALEMATE;
 
-				adding = malloc((string_getlen(userinput) + 1) * sizeof(char));
-				string_copy(adding, userinput);
-				add_move(&(board->Moves), adding);
+				set_result(&(board->Moves), userinput);
 				break;
 			}
 			else if(userinput[0] != '*' && userinput[1] != '\0')
@@ -200,42 +373,28 @@ int_fast8_t mainloop(Game *board, clargs_t clargenborgen)
 
 		if(moved)
 		{
-			int_fast8_t whosturnnext, lastmovelen;
-			char *lastmove;
+			int_fast8_t whosturnnext;
+			const Ply *lastmove;
 
 
-			whosturnnext = board->Moves.LatestMove->Black != NULL ? TEAM_WHITE : TEAM_BLACK;
-			lastmove = whosturnnext == TEAM_WHITE ? board->Moves.LatestMove->Black : board->Moves.LatestMove->White;
-			if(flags & ML_PRINT) printf("lastmove = %s\n", lastmove);
+			whosturnnext = whose_turn(board);
+			lastmove = get_latest_move(board->Moves);
+			if(flags & ML_PRINT)
+			{
+				char san[PLY_SAN_LENGTH];
+
+				ply_to_PGN(san, *lastmove);
+				printf("lastmove = %s\n", san);
+			}
 
-			lastmovelen = string_getlen(lastmove);
-			if(lastmove[lastmovelen - 1] == '#')
+			if(lastmove->notes & PLY_MATE)
 			{
 				checkmate = whosturnnext == TEAM_WHITE ? TEAM_BLACK : TEAM_WHITE;
 			}
 			else
 			{
 				/* check if stalemate */
-				uint_fast8_t i, x, y;
-				Location loc;
-				Piece **Pieces;
-				
-				Pieces = whosturnnext == TEAM_WHITE ? board->White : board->Black;
-				stalemate = PB_STALEMATE;
-				for(i = 0; stalemate && i < PIECES_PER_SIDE; i++)
-				{
-					for(x = 1; stalemate && x <= 8; x++)
-					{
-						for(y = 1; stalemate && y <= 8; y++)
-						{
-							location_assign(&loc, x, y);
-                           
-							if(Pieces[i]->currentLocation != 0 && !(location_equals_coords(Pieces[i]->currentLocation, x, y)) &&
-							   is_valid_move(board, Pieces[i], loc, 0))
-								stalemate = 0;
-						}
-					}
-				}
+				stalemate = position_status(board) & CHECK_STALEMATE ? PB_STALEMATE : 0;
 				if(flags & ML_PRINT) printf("stalemate = %" PRIdFAST8 "\n", stalemate);
 			}
 		}
@@ -246,22 +405,10 @@ int_fast8_t mainloop(Game *board, clargs_t clargenborgen)
 
 	if(readingFile)
 	{
-		uintmax_t i;
 		if(checkmate)
-		{
-			char *strToCopy, *mallocd;
-
-			strToCopy = checkmate == TEAM_WHITE ? "1-0" : "0-1";
-
-			mallocd = malloc(4 * sizeof(char));
-			string_copy(mallocd, strToCopy);
-
-			add_move(&(board->Moves), mallocd);
-		}
+			set_result(&(board->Moves), checkmate == TEAM_WHITE ? "1-0" : "0-1");
 
-		for(i = 0; i < filemoves_size; i++)
-			free(filemoves[i]);
-		free(filemoves);
+		pgn_close(&reader);
 	}
 
 	return stalemate | checkmate;